@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Eigen/Sparse>
+
+class ImplicitOperator;
+
+namespace Eigen::internal {
+template <> struct traits<ImplicitOperator> : public traits<SparseMatrix<double>> {};
+} // namespace Eigen::internal
+
+/**
+ * Matrix-free form of the implicit operator (I - dt * Laplacian) over the compact numbering of interior nodes.
+ * Applies the 5-point stencil on the fly; border and outer neighbours are eliminated exactly as in the assembled
+ * system. Only the numbering maps between the grid and the unknowns are stored.
+ */
+class ImplicitOperator : public Eigen::EigenBase<ImplicitOperator> {
+    Eigen::VectorXi _nodes;
+    Eigen::VectorXi _index;
+    int _rows = 0;
+    double _rx = 0.;
+    double _ry = 0.;
+
+  public:
+    using Scalar = double;
+    using RealScalar = double;
+    using StorageIndex = int;
+    enum { ColsAtCompileTime = Eigen::Dynamic, MaxColsAtCompileTime = Eigen::Dynamic, IsRowMajor = false };
+
+    ImplicitOperator() = default;
+    /**
+     * @param nodes storage index (i + j * rows) of every unknown
+     * @param index unknown number of every grid node, -1 for the known ones
+     */
+    ImplicitOperator(Eigen::VectorXi nodes, Eigen::VectorXi index, int rows, double rx, double ry);
+
+    [[nodiscard]] Index rows() const { return _nodes.size(); }
+    [[nodiscard]] Index cols() const { return _nodes.size(); }
+
+    template <typename Rhs>
+    Eigen::Product<ImplicitOperator, Rhs, Eigen::AliasFreeProduct> operator*(const Eigen::MatrixBase<Rhs> &x) const {
+        return {*this, x.derived()};
+    }
+
+    /// y += alpha * A * x
+    void apply(const Eigen::Ref<const Eigen::VectorXd> &x, Eigen::Ref<Eigen::VectorXd> y, double alpha) const;
+};
+
+namespace Eigen::internal {
+template <typename Rhs>
+struct generic_product_impl<ImplicitOperator, Rhs, SparseShape, DenseShape, GemvProduct>
+    : generic_product_impl_base<ImplicitOperator, Rhs, generic_product_impl<ImplicitOperator, Rhs>> {
+    using Scalar = typename Product<ImplicitOperator, Rhs>::Scalar;
+
+    template <typename Dest>
+    static void scaleAndAddTo(Dest &dst, const ImplicitOperator &lhs, const Rhs &rhs, const Scalar &alpha) {
+        lhs.apply(rhs, dst, alpha);
+    }
+};
+} // namespace Eigen::internal
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <vector>
+
+#include "object.h"
+
+/**
+ * Geometric multigrid for the implicit operator (I - dt * Laplacian) on the structured plate grid.
+ * Vectors use the compact numbering of the implicit system and are scattered onto the finest grid level, whose
+ * storage index (i + j * rows) every unknown carries; nodes from the `known` set are fixed.
+ * Coarse levels inject the node classification from every other node, so the hole and the outer area stay fixed
+ * (zero correction) on every level. Can be used standalone or as a preconditioner for Eigen::ConjugateGradient.
+ */
+class Multigrid {
+    struct Level {
+        int rows = 0;
+        int cols = 0;
+        double rx = 0.;
+        double ry = 0.;
+        std::vector<char> interior;
+        Eigen::VectorXd u;
+        Eigen::VectorXd f;
+        Eigen::VectorXd r;
+    };
+
+    // Levels double as the cycle workspace, so the const preconditioner interface can still run V-cycles
+    mutable std::vector<Level> levels;
+    Eigen::VectorXi unknownNodes;
+    int smoothingSweeps = 2;
+    int coarseSweeps = 50;
+    // Whether the last standalone solve reached its tolerance
+    mutable bool converged = true;
+
+    static void smooth(Level &level, bool reversed);
+    static void residual(Level &level);
+    static void restrictResidual(const Level &fine, Level &coarse);
+    static void prolongate(const Level &coarse, Level &fine);
+    void vcycle(std::size_t depth) const;
+    void scatter(const Eigen::VectorXd &unknowns, Eigen::VectorXd &grid) const;
+    [[nodiscard]] Eigen::VectorXd gather(const Eigen::VectorXd &grid) const;
+
+  public:
+    Multigrid() = default;
+    Multigrid(const Eigen::MatrixX<ObjectBound> &parts, ObjectBound known, Eigen::VectorXi unknownNodes, double dt,
+              double step);
+
+    /**
+     * Runs V-cycles starting from `x` until the relative residual drops below `tolerance`. Stopping at `maxCycles`
+     * first makes info() report Eigen::NoConvergence.
+     * @return number of cycles performed
+     */
+    int solveWithGuess(const Eigen::VectorXd &b, Eigen::VectorXd &x, double tolerance, int maxCycles) const;
+
+    // Preconditioner interface: the hierarchy is built from the grid, so the matrix is not needed
+    template <typename MatrixType> Multigrid &analyzePattern(const MatrixType &) { return *this; }
+    template <typename MatrixType> Multigrid &factorize(const MatrixType &) { return *this; }
+    template <typename MatrixType> Multigrid &compute(const MatrixType &) { return *this; }
+
+    /// Applies a single V-cycle with a zero initial guess
+    [[nodiscard]] Eigen::VectorXd solve(const Eigen::VectorXd &b) const;
+
+    [[nodiscard]] Eigen::ComputationInfo info() const {
+        if (levels.empty())
+            return Eigen::InvalidInput;
+        return converged ? Eigen::Success : Eigen::NoConvergence;
+    }
+};
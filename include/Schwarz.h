@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Eigen/Sparse>
+#include <memory>
+#include <vector>
+
+/**
+ * Overlapping additive Schwarz preconditioner for the implicit operator.
+ * The plate is cut into strips of whole grid columns, one per thread, each extended by `overlap` columns on both
+ * sides. Unknowns keep the grid column order, so every strip is a contiguous block of unknowns whose system is
+ * factorized and solved independently; the local solutions are summed, which keeps the preconditioner symmetric.
+ */
+class AdditiveSchwarz {
+    struct Subdomain {
+        Eigen::Index start;
+        Eigen::Index size;
+        std::unique_ptr<Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>> factorization;
+    };
+
+    std::vector<Subdomain> subdomains;
+    int subdomainCount = 1;
+    Eigen::VectorXi lineOffsets;
+    int overlap = 0;
+    Eigen::ComputationInfo status = Eigen::InvalidInput;
+
+  public:
+    AdditiveSchwarz() = default;
+
+    /**
+     * @param lineOffsets index of the first unknown of every grid column, followed by the total number of unknowns
+     */
+    void setup(int subdomains, Eigen::VectorXi lineOffsets, int overlap);
+
+    template <typename MatrixType> AdditiveSchwarz &analyzePattern(const MatrixType &) { return *this; }
+    template <typename MatrixType> AdditiveSchwarz &factorize(const MatrixType &matrix) { return compute(matrix); }
+    template <typename MatrixType> AdditiveSchwarz &compute(const MatrixType &matrix) {
+        factorizeSubdomains(matrix);
+        return *this;
+    }
+
+    void factorizeSubdomains(const Eigen::SparseMatrix<double> &matrix);
+
+    [[nodiscard]] Eigen::VectorXd solve(const Eigen::VectorXd &b) const;
+
+    [[nodiscard]] Eigen::ComputationInfo info() const { return status; }
+};
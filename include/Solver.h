@@ -1,69 +1,257 @@
 #pragma once
 
+#include "ImplicitOperator.h"
+#include "Multigrid.h"
+#include "Schwarz.h"
 #include "mesh.h"
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
+#include <vector>
+
 template <typename T> using Tensor3 = Eigen::VectorX<Eigen::MatrixX<T>>;
 
 struct Solution {
     Tensor3<float> timeMesh;
     double step;
+    std::vector<int> linearIterations = {};
+    // Layer at which the solution stopped changing, if the run ended early on it
+    std::optional<int> steadyLayer = {};
+    // Layer of timeMesh(0), a run seeded from a coarse steady state starts where the coarse one stopped
+    int firstLayer = 0;
 };
 
-class Solver {
+/**
+ * @tparam Scalar precision of the stored time layers and of the explicit kernels. The implicit linear systems are
+ * always solved in double, the layers are converted when they are gathered and written back.
+ */
+template <typename Scalar> class Solver {
     using Index = Eigen::Vector2i;
+    using Layer = Eigen::MatrixX<Scalar>;
+
+    /// Interior nodes (i, j) ... (i + length - 1, j), contiguous in the column-major layers
+    struct NodeRun {
+        Index start;
+        int length;
+    };
+
+    /**
+     * Cached geometry of a border node: storage offsets of the node and of the neighbours towards the interior its
+     * update reads along x, along y and diagonally, plus the terms of its outward normal.
+     */
+    struct BorderStencil {
+        int node;
+        int x;
+        int y;
+        int diagonal;
+        // Sign of the one-sided differences relative to (neighbour - node)
+        double signX;
+        double signY;
+        double normalX;
+        double normalY;
+        // Reciprocals of the normal components, zero where the component is
+        double inverseX;
+        double inverseY;
+    };
+
+    /// Border nodes under one condition, in storage order
+    struct BorderGroup {
+        bool convection;
+        std::vector<BorderStencil> stencils;
+        // First node of every row chunk of every column (j * columnChunks + c), then the node count
+        std::vector<int> chunkStarts;
+    };
+
+    /**
+     * Square block of the plate with its own copy of the node lists. A tile is skipped while it and its neighbours
+     * are settled, since every node update only reads the adjacent nodes, and until the change it missed since it was
+     * last computed would reach the tolerance.
+     */
+    struct Tile {
+        int row;
+        int col;
+        int rows;
+        int cols;
+        std::vector<NodeRun> runs;
+        std::vector<BorderGroup> borders;
+        // Largest change of a node on the last measured layer, zero if the tile was skipped
+        double change = std::numeric_limits<double>::infinity();
+        // Largest change of a node the last time the tile was measured while computed
+        double rate = std::numeric_limits<double>::infinity();
+        // Sum of the rates over the layers skipped since the tile was last computed
+        double drift = 0.;
+        // Both layers hold the same values in the tile
+        bool synced = false;
+    };
+
+    static constexpr int TileSize = 32;
 
-    Tensor3<Node> T;
+    /**
+     * Coefficients of one RKL2 stage
+     * Y_j = mu Y_j-1 + nu Y_j-2 + (1 - mu - nu) Y_0 + muTilde dt L(Y_j-1) + gammaTilde dt L(Y_0)
+     */
+    struct SuperStage {
+        double mu;
+        double nu;
+        double muTilde;
+        double gammaTilde;
+    };
+
+    struct OperatorKey {
+        double dt;
+        double step;
+        config::SolvingMethod scheme;
+        config::LinearSolver solver;
+        ObjectBound border;
+        config::HoleType hole;
+        Eigen::Vector2d holeCenter;
+
+        bool operator==(const OperatorKey &) const = default;
+    };
+
+    Tensor3<Scalar> T;
     Tensor3<float> SavedTemperatures;
+    Eigen::MatrixX<ObjectBound> parts;
     double step;
     config::TaskParameters params;
     int SizeT;
     double dt;
-    Eigen::MatrixXd meshCoeffs;
+    Eigen::SparseMatrix<double> meshCoeffs;
+    Eigen::SparseMatrix<double, Eigen::RowMajor> borderCoupling;
+    Eigen::VectorXi unknownIndex;
+    Eigen::VectorXi unknownNodes;
+    config::LinearSolver linearSolver;
+    config::FillOrdering fillOrdering;
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> fillPermutation;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Lower, Eigen::NaturalOrdering<int>> factorization;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<float>, Eigen::Lower, Eigen::NaturalOrdering<int>> floatFactorization;
+    Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper> jacobiCG;
+    Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper,
+                             Eigen::IncompleteCholesky<double>>
+        choleskyCG;
+    Multigrid multigrid;
+    Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper, Multigrid> multigridCG;
+    ImplicitOperator implicitOperator;
+    Eigen::ConjugateGradient<ImplicitOperator, Eigen::Lower | Eigen::Upper, Multigrid> matrixFreeCG;
+    Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper, AdditiveSchwarz> schwarzCG;
+    double relaxation = 1.;
+    double weightedDt = 0.;
+    double tolerance;
+    unsigned int parallelism;
+    std::optional<OperatorKey> factorizedFor;
+    std::vector<int> linearIterations;
     Eigen::VectorXd meshFreeCoeffs;
+    Eigen::VectorXd previousLayer;
+    Eigen::MatrixXd halfLayer;
+    Eigen::MatrixXd relaxationLayer;
+    std::vector<BorderGroup> borderGroups;
+    std::vector<NodeRun> interiorRuns;
+    std::vector<int> runChunkStarts;
+    // Row chunks per column in the blocked mode, so that every thread has work on each wavefront step
+    int columnChunks = 1;
+    int timeBlock;
+    bool adaptiveStep;
+    // Explicit steps over the whole run, spread evenly over the time layers
+    int explicitSteps = 0;
+    double skipTolerance;
+    std::vector<Tile> tiles;
+    int tileColumns = 0;
+    std::vector<char> activeTiles;
+    // Layer within the current tile epoch, the skipped tiles are chosen on its first one
+    int tileLayer = 0;
+    bool allTilesActive = true;
+    double steadyTolerance;
+    // Largest change of a node over the last step, only measured while looking for the steady state
+    double layerChange = std::numeric_limits<double>::infinity();
+    bool superTimeStepping;
+    std::vector<SuperStage> superStages;
+    std::array<Layer, 2> stageLayers;
+    Layer initialRate;
 
-    [[nodiscard]] double explicitCentralDifference(const Index &index) const;
-    [[nodiscard]] double applyBorderConvection(const Index &index) const;
-    [[nodiscard]] double applyBorderInsulation(const Index &index) const ;
-    void implicitCentralDifference();
-    [[nodiscard]] Eigen::MatrixXd buildCoefficientMatrix() const;
-    [[nodiscard]] Eigen::VectorXd buildFreeDicksVector() const;
+    [[nodiscard]] double explicitCentralDifference(const Index &index, const Layer &layer) const;
+    [[nodiscard]] BorderStencil borderStencil(const Index &index, ObjectBound part) const;
+    [[nodiscard]] double applyBorderConvection(const BorderStencil &stencil, const Scalar *layer) const;
+    [[nodiscard]] double applyBorderInsulation(const BorderStencil &stencil, const Scalar *layer) const;
+    template <bool Convection>
+    void updateBorderNodes(const BorderGroup &group, int begin, int end, const Layer &layer, Layer &next) const;
+    void updateBorderGroup(const BorderGroup &group, int begin, int end, const Layer &layer, Layer &next) const;
+    [[nodiscard]] double borderChange(const BorderGroup &group, int begin, int end, const Layer &layer,
+                                      const Layer &next) const;
+    double updateBorders(const Layer &layer, Layer &next) const;
+    [[nodiscard]] bool isInterior(ObjectBound part) const;
+    void classifyNodes();
+    void explicitRun(const NodeRun &run, const Layer &layer, Layer &next) const;
+    [[nodiscard]] double runChange(const NodeRun &run, const Layer &layer, const Layer &next) const;
+    double explicitInteriorKernel();
+    [[nodiscard]] double interiorChange() const;
+    void explicitChunk(int chunk, const Layer &layer, Layer &next) const;
+    void buildTiles();
+    double explicitTiledStep();
+    void solveExplicitBlock(int layers);
+    void advanceExplicit(int steps);
+    [[nodiscard]] static std::vector<SuperStage> rkl2Stages(int stages);
+    void superStage(const SuperStage &stage, const Layer &previous, const Layer &older, Layer &next, bool first);
+    void superBorders(bool hold);
+    void superTimeStep();
+    [[nodiscard]] double stableExplicitDt() const;
+    void prepareImplicitOperator(config::SolvingMethod scheme);
+    void implicitCentralDifference(config::SolvingMethod scheme);
+    [[nodiscard]] Eigen::SparseMatrix<double> buildCoefficientMatrix(config::SolvingMethod scheme) const;
+    [[nodiscard]] Eigen::SparseMatrix<double, Eigen::RowMajor>
+    buildBorderCouplingMatrix(config::SolvingMethod scheme) const;
+    [[nodiscard]] Eigen::VectorXd buildFreeDicksVector(config::SolvingMethod scheme,
+                                                       const Eigen::VectorXd &current) const;
+    [[nodiscard]] Eigen::VectorXd borderTerms(int time) const;
+    [[nodiscard]] Eigen::VectorXd unknownsVector(int time) const;
+    int refineMixedSolution(Eigen::VectorXd &x) const;
+    int successiveOverRelaxation();
+    [[nodiscard]] Multigrid buildMultigrid(config::SolvingMethod scheme) const;
+    [[nodiscard]] Eigen::SparseMatrix<double> permutedCoefficientMatrix();
+    void alternatingDirectionImplicit();
 
     template <config::SolvingMethod Type> void solveNextLayer();
+    template <config::SolvingMethod Type> Solution solveLayers();
 
   public:
     Solver(Mesh &&mesh, const config::Constants &consts);
 
+    /**
+     * Starts from the last layer of the same task solved with twice the grid step. Fine nodes take the bilinear
+     * interpolation of the coarse nodes around them that lie on the plate; heat nodes keep their fixed temperature.
+     */
+    void initializeFromCoarse(const Solution &coarse);
+
     Solution solveExplicit();
     Solution solveImplicit();
+    Solution solveADI();
+    Solution solveCrankNicolson();
+    Solution solveBDF2();
 
-    [[nodiscard]] Eigen::Vector2d getNormalToBorder(const Index &index, const Node &node) const;
+    [[nodiscard]] Eigen::Vector2d getNormalToBorder(const Index &index, ObjectBound part) const;
 };
 
-template <config::SolvingMethod Type> void Solver::solveNextLayer() {
-    using namespace EnumBitmask;
-
-    const auto rows = T(0).rows();
-    const auto cols = T(0).cols();
-
-#pragma omp parallel for shared(rows, cols)
-    for (int i = 0; i < rows; i++)
-        for (int j = 0; j < cols; j++) {
-            auto &[t, part, _] = T(1)(i, j);
-            if (contains(params.border.Heat, part)) {
-                t = 100;
-                if (part == ObjectBound::R2)
-                    t = 200;
-            } else if (contains(params.border.Convection, part))
-                t = applyBorderConvection({i, j});
-            else if (contains(params.border.ThermalInsulation, part))
-                t = applyBorderInsulation({i, j});
-            else if (!contains(ObjectBounds::Outer, part))
-                if constexpr (Type == config::SolvingMethod::Explicit)
-                    t = explicitCentralDifference({i, j});
-        }
-
-    if constexpr (Type == config::SolvingMethod::Implicit)
-        implicitCentralDifference();
+template <typename Scalar> template <config::SolvingMethod Type> void Solver<Scalar>::solveNextLayer() {
+    // Heat nodes are fixed in both layers at construction, outer nodes are never touched
+    if constexpr (Type == config::SolvingMethod::Explicit) {
+        if (tiles.empty()) {
+            const auto borders = updateBorders(T(0), T(1));
+            layerChange = std::max(borders, explicitInteriorKernel());
+        } else
+            layerChange = explicitTiledStep();
+    } else
+        layerChange = updateBorders(T(0), T(1));
+
+    if constexpr (Type == config::SolvingMethod::Implicit || Type == config::SolvingMethod::CrankNicolson ||
+                  Type == config::SolvingMethod::BDF2)
+        implicitCentralDifference(Type);
+    else if constexpr (Type == config::SolvingMethod::ADI)
+        alternatingDirectionImplicit();
+
+    if constexpr (Type != config::SolvingMethod::Explicit)
+        if (steadyTolerance >= 0.)
+            layerChange = std::max(layerChange, interiorChange());
 
     T(0).swap(T(1));
 }
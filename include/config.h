@@ -40,7 +40,20 @@ struct TaskParameters {
 };
 
 enum class RenderKind { OutputAll, OutputLast, RenderGif, RenderLast, RenderVideo, NoOutput };
-enum class SolvingMethod { Explicit, Implicit };
+enum class SolvingMethod { Explicit, Implicit, ADI, CrankNicolson, BDF2 };
+enum class FillOrdering { AMD, NestedDissection };
+enum class Precision { Double, Float };
+enum class LinearSolver {
+    Direct,
+    MixedDirect,
+    JacobiCG,
+    CholeskyCG,
+    Multigrid,
+    MultigridCG,
+    MatrixFreeCG,
+    RedBlackSOR,
+    SchwarzCG
+};
 
 struct Constants {
     int TimeLayers = 100;
@@ -56,6 +69,19 @@ struct Constants {
     unsigned int Parallelism = std::thread::hardware_concurrency();
     RenderKind Kind = RenderKind::OutputLast;
     SolvingMethod SolveMethod = SolvingMethod::Explicit;
+    LinearSolver ImplicitSolver = LinearSolver::Direct;
+    double SolverTolerance = 1e-8;
+    FillOrdering Ordering = FillOrdering::AMD;
+    int TimeBlock = 1;
+    bool AdaptiveStep = false;
+    Precision LayerPrecision = Precision::Double;
+    // Largest change a plate tile may miss between two explicit updates of it; negative disables skipping
+    double SkipTolerance = -1.;
+    // Stop once no node changes by more than this over a time step; negative runs all layers
+    double SteadyTolerance = -1.;
+    // Number of times the grid step is doubled for runs whose steady state seeds the next finer one
+    int CoarseLevels = 0;
+    bool SuperTimeStepping = false;
 
     [[nodiscard]] bool isDefault() const;
 
@@ -85,6 +111,16 @@ template <> struct convert<Constants> {
         IfNotDefault(SquareSide, "square_size");
         IfNotDefault(Kind, "render_kind");
         IfNotDefault(SolveMethod, "solving_method");
+        IfNotDefault(ImplicitSolver, "linear_solver");
+        IfNotDefault(SolverTolerance, "solver_tolerance");
+        IfNotDefault(Ordering, "fill_ordering");
+        IfNotDefault(TimeBlock, "time_block");
+        IfNotDefault(AdaptiveStep, "adaptive_step");
+        IfNotDefault(LayerPrecision, "precision");
+        IfNotDefault(SkipTolerance, "skip_tolerance");
+        IfNotDefault(SteadyTolerance, "steady_tolerance");
+        IfNotDefault(CoarseLevels, "coarse_levels");
+        IfNotDefault(SuperTimeStepping, "super_time_stepping");
         IfNotDefault(ExportMeshOnly, "export_mesh_only");
         IfNotDefault(Parallelism, "parallelism");
         return node;
@@ -104,6 +140,16 @@ template <> struct convert<Constants> {
         rhs.SquareSide = node["square_size"].as<double>(rhs.SquareSide);
         rhs.Kind = node["render_kind"].as<RenderKind>(rhs.Kind);
         rhs.SolveMethod = node["solving_method"].as<SolvingMethod>(rhs.SolveMethod);
+        rhs.ImplicitSolver = node["linear_solver"].as<LinearSolver>(rhs.ImplicitSolver);
+        rhs.SolverTolerance = node["solver_tolerance"].as<double>(rhs.SolverTolerance);
+        rhs.Ordering = node["fill_ordering"].as<FillOrdering>(rhs.Ordering);
+        rhs.TimeBlock = node["time_block"].as<int>(rhs.TimeBlock);
+        rhs.AdaptiveStep = node["adaptive_step"].as<bool>(rhs.AdaptiveStep);
+        rhs.LayerPrecision = node["precision"].as<config::Precision>(rhs.LayerPrecision);
+        rhs.SkipTolerance = node["skip_tolerance"].as<double>(rhs.SkipTolerance);
+        rhs.SteadyTolerance = node["steady_tolerance"].as<double>(rhs.SteadyTolerance);
+        rhs.CoarseLevels = node["coarse_levels"].as<int>(rhs.CoarseLevels);
+        rhs.SuperTimeStepping = node["super_time_stepping"].as<bool>(rhs.SuperTimeStepping);
         rhs.ExportMeshOnly = node["export_mesh_only"].as<bool>(rhs.ExportMeshOnly);
         rhs.Parallelism = node["parallelism"].as<unsigned int>(rhs.Parallelism);
 
@@ -165,6 +211,12 @@ template <> struct convert<SolvingMethod> {
             method = SolvingMethod::Explicit;
         else if (value == "implicit")
             method = SolvingMethod::Implicit;
+        else if (value == "adi")
+            method = SolvingMethod::ADI;
+        else if (value == "crank nicolson")
+            method = SolvingMethod::CrankNicolson;
+        else if (value == "bdf2")
+            method = SolvingMethod::BDF2;
         else
             return false;
         return true;
@@ -176,6 +228,118 @@ template <> struct convert<SolvingMethod> {
             node = "explicit";
         else if (method == SolvingMethod::Implicit)
             node = "implicit";
+        else if (method == SolvingMethod::ADI)
+            node = "adi";
+        else if (method == SolvingMethod::CrankNicolson)
+            node = "crank nicolson";
+        else if (method == SolvingMethod::BDF2)
+            node = "bdf2";
+
+        return node;
+    }
+};
+
+template <> struct convert<LinearSolver> {
+    static bool decode(const Node &node, LinearSolver &solver) {
+        if (!node.IsScalar())
+            return false;
+
+        auto value = node.as<std::string>();
+        if (value == "direct")
+            solver = LinearSolver::Direct;
+        else if (value == "direct mixed")
+            solver = LinearSolver::MixedDirect;
+        else if (value == "cg jacobi")
+            solver = LinearSolver::JacobiCG;
+        else if (value == "cg cholesky")
+            solver = LinearSolver::CholeskyCG;
+        else if (value == "multigrid")
+            solver = LinearSolver::Multigrid;
+        else if (value == "cg multigrid")
+            solver = LinearSolver::MultigridCG;
+        else if (value == "cg matrix free")
+            solver = LinearSolver::MatrixFreeCG;
+        else if (value == "sor")
+            solver = LinearSolver::RedBlackSOR;
+        else if (value == "cg schwarz")
+            solver = LinearSolver::SchwarzCG;
+        else
+            return false;
+        return true;
+    }
+
+    static Node encode(const LinearSolver &solver) {
+        Node node;
+        if (solver == LinearSolver::Direct)
+            node = "direct";
+        else if (solver == LinearSolver::MixedDirect)
+            node = "direct mixed";
+        else if (solver == LinearSolver::JacobiCG)
+            node = "cg jacobi";
+        else if (solver == LinearSolver::CholeskyCG)
+            node = "cg cholesky";
+        else if (solver == LinearSolver::Multigrid)
+            node = "multigrid";
+        else if (solver == LinearSolver::MultigridCG)
+            node = "cg multigrid";
+        else if (solver == LinearSolver::MatrixFreeCG)
+            node = "cg matrix free";
+        else if (solver == LinearSolver::RedBlackSOR)
+            node = "sor";
+        else if (solver == LinearSolver::SchwarzCG)
+            node = "cg schwarz";
+
+        return node;
+    }
+};
+
+template <> struct convert<FillOrdering> {
+    static bool decode(const Node &node, FillOrdering &ordering) {
+        if (!node.IsScalar())
+            return false;
+
+        auto value = node.as<std::string>();
+        if (value == "amd")
+            ordering = FillOrdering::AMD;
+        else if (value == "nested dissection")
+            ordering = FillOrdering::NestedDissection;
+        else
+            return false;
+        return true;
+    }
+
+    static Node encode(const FillOrdering &ordering) {
+        Node node;
+        if (ordering == FillOrdering::AMD)
+            node = "amd";
+        else if (ordering == FillOrdering::NestedDissection)
+            node = "nested dissection";
+
+        return node;
+    }
+};
+
+template <> struct convert<config::Precision> {
+    static bool decode(const Node &node, config::Precision &precision) {
+        if (!node.IsScalar())
+            return false;
+
+        auto value = node.as<std::string>();
+        if (value == "double")
+            precision = config::Precision::Double;
+        else if (value == "float")
+            precision = config::Precision::Float;
+        else
+            return false;
+        return true;
+    }
+
+    static Node encode(const config::Precision &precision) {
+        Node node;
+        if (precision == config::Precision::Double)
+            node = "double";
+        else if (precision == config::Precision::Float)
+            node = "float";
 
         return node;
     }
@@ -12,7 +12,7 @@ struct Node {
 };
 
 class Mesh {
-    friend class Solver;
+    template <typename Scalar> friend class Solver;
 
   private:
     Eigen::MatrixX<Node> nodes;
@@ -0,0 +1,22 @@
+#include <utility>
+
+#include "ImplicitOperator.h"
+
+ImplicitOperator::ImplicitOperator(Eigen::VectorXi nodes, Eigen::VectorXi index, const int rows, const double rx,
+                                   const double ry)
+    : _nodes(std::move(nodes)), _index(std::move(index)), _rows(rows), _rx(rx), _ry(ry) {}
+
+void ImplicitOperator::apply(const Eigen::Ref<const Eigen::VectorXd> &x, Eigen::Ref<Eigen::VectorXd> y,
+                             const double alpha) const {
+    const auto diagonal = 1. + 2. * _rx + 2. * _ry;
+    const auto size = static_cast<int>(_nodes.size());
+    const auto neighbour = [&](const int k) { return _index(k) >= 0 ? x(_index(k)) : 0.; };
+
+#pragma omp parallel for
+    for (int unknown = 0; unknown < size; unknown++) {
+        const auto k = _nodes(unknown);
+        const auto product = diagonal * x(unknown) - _rx * (neighbour(k - 1) + neighbour(k + 1)) -
+                             _ry * (neighbour(k - _rows) + neighbour(k + _rows));
+        y(unknown) += alpha * product;
+    }
+}
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <utility>
+
+#include "Multigrid.h"
+
+Multigrid::Multigrid(const Eigen::MatrixX<ObjectBound> &parts, const ObjectBound known, Eigen::VectorXi unknownNodes,
+                     const double dt, const double step)
+    : unknownNodes(std::move(unknownNodes)) {
+    Eigen::MatrixX<ObjectBound> levelParts = parts;
+    double h = step;
+
+    while (true) {
+        Level level;
+        level.rows = static_cast<int>(levelParts.rows());
+        level.cols = static_cast<int>(levelParts.cols());
+        level.rx = dt / h / h;
+        level.ry = dt / h / h;
+        level.interior.resize(levelParts.size());
+        for (int j = 0; j < level.cols; j++)
+            for (int i = 0; i < level.rows; i++)
+                level.interior[i + j * level.rows] = !EnumBitmask::contains(known, levelParts(i, j));
+        level.u = Eigen::VectorXd::Zero(levelParts.size());
+        level.f = Eigen::VectorXd::Zero(levelParts.size());
+        level.r = Eigen::VectorXd::Zero(levelParts.size());
+        levels.push_back(std::move(level));
+
+        if (std::min(levelParts.rows(), levelParts.cols()) <= 8)
+            break;
+
+        /**
+         * Coarse node (I, J) sits on fine node (2I, 2J); nodes past the fine grid are treated as outer
+         */
+        const auto coarseRows = levelParts.rows() / 2 + 1;
+        const auto coarseCols = levelParts.cols() / 2 + 1;
+        Eigen::MatrixX<ObjectBound> coarseParts(coarseRows, coarseCols);
+        for (int i = 0; i < coarseRows; i++)
+            for (int j = 0; j < coarseCols; j++)
+                coarseParts(i, j) = 2 * i < levelParts.rows() && 2 * j < levelParts.cols() ? levelParts(2 * i, 2 * j)
+                                                                                          : ObjectBounds::Outer;
+        levelParts = std::move(coarseParts);
+        h *= 2;
+    }
+}
+
+void Multigrid::smooth(Level &level, const bool reversed) {
+    const auto rows = level.rows;
+    const auto cols = level.cols;
+    const auto diagonal = 1. + 2. * level.rx + 2. * level.ry;
+    const auto &interior = level.interior;
+    auto &u = level.u;
+    const auto &f = level.f;
+
+    /**
+     * Red-black Gauss-Seidel. The reversed colour order is the transpose of the forward sweep,
+     * which keeps the V-cycle symmetric as required by CG.
+     */
+    for (int pass = 0; pass < 2; pass++) {
+        const auto colour = reversed ? 1 - pass : pass;
+
+#pragma omp parallel for
+        for (int j = 0; j < cols; j++)
+            for (int i = (j + colour) % 2; i < rows; i += 2) {
+                const auto k = i + j * rows;
+                if (!interior[k]) {
+                    u(k) = f(k);
+                    continue;
+                }
+
+                double sum = f(k);
+                if (interior[k - 1])
+                    sum += level.rx * u(k - 1);
+                if (interior[k + 1])
+                    sum += level.rx * u(k + 1);
+                if (interior[k - rows])
+                    sum += level.ry * u(k - rows);
+                if (interior[k + rows])
+                    sum += level.ry * u(k + rows);
+                u(k) = sum / diagonal;
+            }
+    }
+}
+
+void Multigrid::residual(Level &level) {
+    const auto rows = level.rows;
+    const auto cols = level.cols;
+    const auto diagonal = 1. + 2. * level.rx + 2. * level.ry;
+    const auto &interior = level.interior;
+    const auto &u = level.u;
+
+#pragma omp parallel for
+    for (int j = 0; j < cols; j++)
+        for (int i = 0; i < rows; i++) {
+            const auto k = i + j * rows;
+            if (!interior[k]) {
+                level.r(k) = level.f(k) - u(k);
+                continue;
+            }
+
+            double product = diagonal * u(k);
+            if (interior[k - 1])
+                product -= level.rx * u(k - 1);
+            if (interior[k + 1])
+                product -= level.rx * u(k + 1);
+            if (interior[k - rows])
+                product -= level.ry * u(k - rows);
+            if (interior[k + rows])
+                product -= level.ry * u(k + rows);
+            level.r(k) = level.f(k) - product;
+        }
+}
+
+void Multigrid::restrictResidual(const Level &fine, Level &coarse) {
+    const auto fineAt = [&](const int i, const int j) {
+        if (i < 0 || j < 0 || i >= fine.rows || j >= fine.cols || !fine.interior[i + j * fine.rows])
+            return 0.;
+        return fine.r(i + j * fine.rows);
+    };
+
+    // Full weighting, i.e. the transpose of bilinear prolongation scaled by 1/4
+#pragma omp parallel for
+    for (int j = 0; j < coarse.cols; j++)
+        for (int i = 0; i < coarse.rows; i++) {
+            const auto k = i + j * coarse.rows;
+            coarse.u(k) = 0.;
+            if (!coarse.interior[k]) {
+                coarse.f(k) = 0.;
+                continue;
+            }
+
+            const auto fi = 2 * i;
+            const auto fj = 2 * j;
+            coarse.f(k) = fineAt(fi, fj) / 4. +
+                          (fineAt(fi - 1, fj) + fineAt(fi + 1, fj) + fineAt(fi, fj - 1) + fineAt(fi, fj + 1)) / 8. +
+                          (fineAt(fi - 1, fj - 1) + fineAt(fi - 1, fj + 1) + fineAt(fi + 1, fj - 1) +
+                           fineAt(fi + 1, fj + 1)) /
+                              16.;
+        }
+}
+
+void Multigrid::prolongate(const Level &coarse, Level &fine) {
+    const auto coarseAt = [&](const int i, const int j) {
+        if (i >= coarse.rows || j >= coarse.cols || !coarse.interior[i + j * coarse.rows])
+            return 0.;
+        return coarse.u(i + j * coarse.rows);
+    };
+
+#pragma omp parallel for
+    for (int j = 0; j < fine.cols; j++)
+        for (int i = 0; i < fine.rows; i++) {
+            const auto k = i + j * fine.rows;
+            if (!fine.interior[k])
+                continue;
+
+            const auto ci = i / 2;
+            const auto cj = j / 2;
+            double correction;
+            if (i % 2 == 0 && j % 2 == 0)
+                correction = coarseAt(ci, cj);
+            else if (i % 2 == 0)
+                correction = (coarseAt(ci, cj) + coarseAt(ci, cj + 1)) / 2.;
+            else if (j % 2 == 0)
+                correction = (coarseAt(ci, cj) + coarseAt(ci + 1, cj)) / 2.;
+            else
+                correction =
+                    (coarseAt(ci, cj) + coarseAt(ci + 1, cj) + coarseAt(ci, cj + 1) + coarseAt(ci + 1, cj + 1)) / 4.;
+            fine.u(k) += correction;
+        }
+}
+
+void Multigrid::vcycle(const std::size_t depth) const {
+    auto &level = levels[depth];
+
+    if (depth + 1 == levels.size()) {
+        for (int sweep = 0; sweep < coarseSweeps; sweep++) {
+            smooth(level, false);
+            smooth(level, true);
+        }
+        return;
+    }
+
+    for (int sweep = 0; sweep < smoothingSweeps; sweep++)
+        smooth(level, false);
+
+    residual(level);
+    restrictResidual(level, levels[depth + 1]);
+    vcycle(depth + 1);
+    prolongate(levels[depth + 1], level);
+
+    for (int sweep = 0; sweep < smoothingSweeps; sweep++)
+        smooth(level, true);
+}
+
+void Multigrid::scatter(const Eigen::VectorXd &unknowns, Eigen::VectorXd &grid) const {
+    grid.setZero();
+    const auto size = static_cast<int>(unknownNodes.size());
+#pragma omp parallel for
+    for (int unknown = 0; unknown < size; unknown++)
+        grid(unknownNodes(unknown)) = unknowns(unknown);
+}
+
+Eigen::VectorXd Multigrid::gather(const Eigen::VectorXd &grid) const {
+    Eigen::VectorXd unknowns(unknownNodes.size());
+    const auto size = static_cast<int>(unknownNodes.size());
+#pragma omp parallel for
+    for (int unknown = 0; unknown < size; unknown++)
+        unknowns(unknown) = grid(unknownNodes(unknown));
+    return unknowns;
+}
+
+int Multigrid::solveWithGuess(const Eigen::VectorXd &b, Eigen::VectorXd &x, const double tolerance,
+                              const int maxCycles) const {
+    auto &top = levels.front();
+    scatter(b, top.f);
+    scatter(x, top.u);
+
+    const auto threshold = tolerance * b.norm();
+    int cycle = 0;
+    residual(top);
+    for (; cycle < maxCycles && top.r.norm() > threshold; cycle++) {
+        vcycle(0);
+        residual(top);
+    }
+    converged = top.r.norm() <= threshold;
+
+    x = gather(top.u);
+    return cycle;
+}
+
+Eigen::VectorXd Multigrid::solve(const Eigen::VectorXd &b) const {
+    auto &top = levels.front();
+    scatter(b, top.f);
+    top.u.setZero();
+    vcycle(0);
+    return gather(top.u);
+}
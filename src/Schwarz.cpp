@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <utility>
+
+#include "Schwarz.h"
+
+void AdditiveSchwarz::setup(const int subdomains, Eigen::VectorXi lineOffsets, const int overlap) {
+    this->subdomainCount = std::max(subdomains, 1);
+    this->lineOffsets = std::move(lineOffsets);
+    this->overlap = overlap;
+}
+
+void AdditiveSchwarz::factorizeSubdomains(const Eigen::SparseMatrix<double> &matrix) {
+    const auto lines = static_cast<int>(lineOffsets.size()) - 1;
+    const auto count = std::min(subdomainCount, lines);
+    const auto linesPerSubdomain = (lines + count - 1) / count;
+
+    subdomains.clear();
+    for (int first = 0; first < lines; first += linesPerSubdomain) {
+        const auto begin = lineOffsets(std::max(first - overlap, 0));
+        const auto end = lineOffsets(std::min(first + linesPerSubdomain + overlap, lines));
+        if (begin == end)
+            continue;
+        subdomains.push_back({begin, end - begin,
+                              std::make_unique<Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>>()});
+    }
+
+    status = Eigen::Success;
+    const auto size = static_cast<int>(subdomains.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int s = 0; s < size; s++) {
+        auto &[start, length, factorization] = subdomains[s];
+        const Eigen::SparseMatrix<double> local = matrix.block(start, start, length, length);
+        factorization->compute(local);
+        if (factorization->info() != Eigen::Success)
+#pragma omp critical
+            status = factorization->info();
+    }
+}
+
+Eigen::VectorXd AdditiveSchwarz::solve(const Eigen::VectorXd &b) const {
+    const auto size = static_cast<int>(subdomains.size());
+    std::vector<Eigen::VectorXd> local(size);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int s = 0; s < size; s++)
+        local[s] = subdomains[s].factorization->solve(b.segment(subdomains[s].start, subdomains[s].size));
+
+    Eigen::VectorXd z = Eigen::VectorXd::Zero(b.size());
+    for (int s = 0; s < size; s++)
+        z.segment(subdomains[s].start, subdomains[s].size) += local[s];
+
+    return z;
+}
@@ -1,27 +1,76 @@
 #include "ProgressBar.h"
 #include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 #include "Solver.h"
 
-Solver::Solver(Mesh &&mesh, const config::Constants &consts)
-    : step(mesh.step), params(mesh.params), SizeT(consts.TimeLayers), dt(consts.DeltaTime) {
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+static constexpr int MaxMultigridCycles = 100;
+static constexpr int MaxRefinementSteps = 20;
+static constexpr int MaxRelaxationSweeps = 1000;
+// Merged explicit steps stay below the limit, where the checkerboard mode would stop decaying
+static constexpr double MergedStepMargin = 0.9;
+static constexpr int SchwarzOverlap = 4;
+
+/**
+ * Flushes denormals to zero on the current thread while alive. The temperature decays by dozens of orders of magnitude
+ * away from the heated borders, which drops a single precision factor into very slow denormal arithmetic.
+ */
+class FlushDenormals {
+#ifdef __SSE__
+    unsigned int saved = _mm_getcsr();
+
+  public:
+    FlushDenormals() { _mm_setcsr(saved | 0x8040); }
+    ~FlushDenormals() { _mm_setcsr(saved); }
+#endif
+};
+
+template <typename Scalar> Solver<Scalar>::Solver(Mesh &&mesh, const config::Constants &consts)
+    : step(mesh.step), params(mesh.params), SizeT(consts.TimeLayers), dt(consts.DeltaTime),
+      linearSolver(consts.ImplicitSolver), fillOrdering(consts.Ordering), tolerance(consts.SolverTolerance),
+      parallelism(consts.Parallelism), timeBlock(std::max(consts.TimeBlock, 1)), adaptiveStep(consts.AdaptiveStep),
+      skipTolerance(consts.SkipTolerance), steadyTolerance(consts.SteadyTolerance),
+      superTimeStepping(consts.SuperTimeStepping) {
+    jacobiCG.setTolerance(tolerance);
+    choleskyCG.setTolerance(tolerance);
+    multigridCG.setTolerance(tolerance);
+    matrixFreeCG.setTolerance(tolerance);
+    schwarzCG.setTolerance(tolerance);
+
+    /**
+     * Only temperatures change between layers, so the two time layers are flat column-major arrays and the node
+     * classification is kept once. Loops over the grid run j outer / i inner to follow that storage.
+     */
     const auto &meshMatrix = mesh.nodes;
     const auto rows = meshMatrix.rows();
     const auto cols = meshMatrix.cols();
     T.resize(2);
+    T(0).resize(rows, cols);
+    T(1).setZero(rows, cols);
+    parts.resize(rows, cols);
 
-    for (int time = 0; time < 2; time++) {
-        T(time).resize(rows, cols);
-        for (int i = 0; i < rows; i++)
-            for (int j = 0; j < cols; j++) {
-                auto &node = T(time)(i, j);
-                auto &meshNode = meshMatrix(i, j);
-                node.part = meshNode.part;
-                node.lambdaMu = meshNode.lambdaMu;
-                if (time == 0)
-                    node.t = meshNode.t;
-            }
+    for (int j = 0; j < cols; j++)
+        for (int i = 0; i < rows; i++) {
+            T(0)(i, j) = meshMatrix(i, j).t;
+            parts(i, j) = meshMatrix(i, j).part;
+        }
+
+    if (timeBlock > 1)
+        columnChunks = std::max(1, (static_cast<int>(parallelism) + timeBlock - 1) / timeBlock);
+    classifyNodes();
+    if (consts.SolveMethod == config::SolvingMethod::Explicit && skipTolerance >= 0.) {
+        // Skipped tiles lag behind by up to the skip tolerance, which would pass a finer steady check too early
+        if (steadyTolerance >= 0. && skipTolerance > steadyTolerance)
+            throw std::runtime_error("Skip tolerance must not exceed the steady tolerance");
+        buildTiles();
     }
 
     if (consts.Kind == config::RenderKind::RenderGif || consts.Kind == config::RenderKind::OutputAll ||
@@ -31,7 +80,45 @@ Solver::Solver(Mesh &&mesh, const config::Constants &consts)
         SavedTemperatures.resize(1);
 }
 
-double Solver::explicitCentralDifference(const Index &index) const {
+template <typename Scalar> void Solver<Scalar>::initializeFromCoarse(const Solution &coarse) {
+    using namespace EnumBitmask;
+
+    if (coarse.timeMesh.size() != 1 || std::abs(coarse.step - 2 * step) > 1e-9 * step)
+        throw std::runtime_error("Coarse solution must hold only its last layer and have twice the grid step");
+
+    const auto &field = coarse.timeMesh(0);
+    const auto rows = static_cast<int>(T(0).rows());
+    const auto cols = static_cast<int>(T(0).cols());
+
+    // Coarse node (I, J) sits on fine node (2I, 2J), which tells whether it lies on the plate
+    const auto onPlate = [&](const int I, const int J) {
+        return I < field.rows() && J < field.cols() && 2 * I < rows && 2 * J < cols &&
+               !contains(ObjectBounds::Outer, parts(2 * I, 2 * J));
+    };
+
+#pragma omp parallel for
+    for (int j = 0; j < cols; j++)
+        for (int i = 0; i < rows; i++) {
+            const auto part = parts(i, j);
+            if (contains(params.border.Heat, part) || contains(ObjectBounds::Outer, part))
+                continue;
+
+            // Bilinear weights are equal among the coarse corners of a fine node; corners in the hole are dropped
+            double sum = 0.;
+            int corners = 0;
+            for (int I = i / 2; I <= (i + 1) / 2; I++)
+                for (int J = j / 2; J <= (j + 1) / 2; J++)
+                    if (onPlate(I, J)) {
+                        sum += field(I, J);
+                        corners++;
+                    }
+            if (corners > 0)
+                T(0)(i, j) = static_cast<Scalar>(sum / corners);
+        }
+}
+
+template <typename Scalar>
+double Solver<Scalar>::explicitCentralDifference(const Index &index, const Layer &layer) const {
     /**
      *     E
      *     |
@@ -39,11 +126,11 @@ double Solver::explicitCentralDifference(const Index &index) const {
      *     |
      *     D
      */
-    const auto &A = T(0)(index.x(), index.y());
-    const auto &B = T(0)(index.x() - 1, index.y());
-    const auto &C = T(0)(index.x() + 1, index.y());
-    const auto &D = T(0)(index.x(), index.y() - 1);
-    const auto &E = T(0)(index.x(), index.y() + 1);
+    const auto &A = layer(index.x(), index.y());
+    const auto &B = layer(index.x() - 1, index.y());
+    const auto &C = layer(index.x() + 1, index.y());
+    const auto &D = layer(index.x(), index.y() - 1);
+    const auto &E = layer(index.x(), index.y() + 1);
 
     const double dx = step;
     const double dy = step;
@@ -51,66 +138,74 @@ double Solver::explicitCentralDifference(const Index &index) const {
     return dt * ((C - 2 * A + B) / dx / dx + (E - 2 * A + D) / dy / dy) + A;
 }
 
-double Solver::applyBorderConvection(const Index &index) const {
-    const auto &node = T(0)(index.x(), index.y());
-    Eigen::Vector2d antiNormal = -getNormalToBorder(index, node);
-    Eigen::Vector4i indexes = {index.x(), index.y(), index.x(), index.y()};
+template <typename Scalar>
+typename Solver<Scalar>::BorderStencil Solver<Scalar>::borderStencil(const Index &index,
+                                                                     const ObjectBound part) const {
+    const Eigen::Vector2d normal = getNormalToBorder(index, part);
+    const Eigen::Vector2d antiNormal = -normal;
+    const auto i = index.x();
+    const auto j = index.y();
+    const auto at = [rows = static_cast<int>(T(0).rows())](const int i, const int j) { return i + j * rows; };
 
     /**
      * (C = F) ---- G    |    G ---- (C = F) | (A = E) - (C = B) | (A = C) - (B = E)
      *    |         |    |    |         |    |    |         |    |    |         |
      * (A = D) - (B = E) | (A = E) - (B = D) |    G ---- (D = F) | (D = F) ---- G
+     *
+     * Both conditions take one-sided differences towards the interior: gradX = (A - B) / dx is (E - node) / dx or
+     * (node - E) / dx, which only differ in sign. The mixed difference of insulation only depends on the product of
+     * the offsets, so it reads the same corner.
      */
+    const auto offsetX = antiNormal.x() < 0. ? -1 : 1;
+    const auto offsetY = antiNormal.y() >= 0. ? 1 : -1;
+    if (i + offsetX < 0 || i + offsetX >= T(0).rows() || j + offsetY < 0 || j + offsetY >= T(0).cols())
+        throw std::runtime_error("Border stencil of node (" + std::to_string(i) + ", " + std::to_string(j) +
+                                 ") leaves the grid");
 
-    if (antiNormal.y() < 0.)
-        indexes.w() = index.y() - 1;
-    if (antiNormal.y() >= 0.)
-        indexes.y() = index.y() + 1;
-    if (antiNormal.x() < 0.)
-        indexes.x() = index.x() - 1;
-    if (antiNormal.x() >= 0.)
-        indexes.z() = index.x() + 1;
-
-    double dx = step, dy = step;
-    const auto &A = T(0)(indexes.x(), index.y());
-    const auto &B = T(0)(indexes.z(), index.y());
-    const auto &C = T(0)(index.x(), indexes.y());
-    const auto &D = T(0)(index.x(), indexes.w());
-
-    const auto &E = indexes.x() != index.x() ? A : B; // outstanding by x node
-    const auto &F = indexes.y() != index.y() ? C : D; // outstanding by y node
-    const auto &G = T(0)(indexes.x() != index.x() ? indexes.x() : indexes.z(),
-                         indexes.y() != index.y() ? indexes.y() : indexes.w());
-
-    const auto gradX = (A - B) / dx;
-    const auto gradY = (C - D) / dy;
+    return {at(i, j),
+            at(i + offsetX, j),
+            at(i, j + offsetY),
+            at(i + offsetX, j + offsetY),
+            antiNormal.x() < 0. ? 1. : -1.,
+            antiNormal.y() >= 0. ? 1. : -1.,
+            normal.x(),
+            normal.y(),
+            normal.x() != 0 ? 1. / normal.x() : 0.,
+            normal.y() != 0 ? 1. / normal.y() : 0.};
+}
+
+template <typename Scalar>
+double Solver<Scalar>::applyBorderConvection(const BorderStencil &stencil, const Scalar *layer) const {
+    const double dx = step, dy = step;
+    const auto node = layer[stencil.node];
+    const auto E = layer[stencil.x]; // outstanding by x node
+    const auto F = layer[stencil.y]; // outstanding by y node
+    const auto G = layer[stencil.diagonal];
+
+    const auto gradX = stencil.signX * (E - node) / dx;
+    const auto gradY = stencil.signY * (F - node) / dy;
     const auto dxdy = G - E - F + node;
 
-    const auto normal = -antiNormal;
-    double result = 0.0;
-    if (normal.x() != 0)
-        result += 1. / normal.x() * (gradX - dxdy * normal.y());
-    if (normal.y() != 0)
-        result += 1. / normal.y() * (gradY - dxdy * normal.x());
-    return result;
+    return stencil.inverseX * (gradX - dxdy * stencil.normalY) + stencil.inverseY * (gradY - dxdy * stencil.normalX);
 }
 
-Eigen::Vector2d Solver::getNormalToBorder(const Solver::Index &index, const Node &node) const {
+template <typename Scalar>
+Eigen::Vector2d Solver<Scalar>::getNormalToBorder(const Index &index, const ObjectBound part) const {
     Eigen::Vector2d normal;
 
-    if (node.part == ObjectBound::L)
+    if (part == ObjectBound::L)
         normal = {-1, 0};
-    if (node.part == ObjectBound::R)
+    if (part == ObjectBound::R)
         normal = {1, 0};
-    if (node.part == ObjectBound::T)
+    if (part == ObjectBound::T)
         normal = {0, 1};
-    if (node.part == ObjectBound::B)
+    if (part == ObjectBound::B)
         normal = {0, -1};
-    if (node.part == ObjectBound::R2)
+    if (part == ObjectBound::R2)
         normal = -Eigen::Vector2d{350. - index.x() * step, 250. - index.y() * step};
-    if (node.part == ObjectBound::R1)
+    if (part == ObjectBound::R1)
         normal = (params.hole.center - Eigen::Vector2d{index.x() * step, index.y() * step});
-    if (node.part == ObjectBound::S) {
+    if (part == ObjectBound::S) {
         Eigen::Vector2d vec = (params.hole.center - Eigen::Vector2d{index.x() * step, index.y() * step});
         normal = vec.x() > vec.y() ? Eigen::Vector2d{0, vec.y()} : Eigen::Vector2d{vec.x(), 0};
     }
@@ -118,129 +213,1163 @@ Eigen::Vector2d Solver::getNormalToBorder(const Solver::Index &index, const Node
     return normal.normalized();
 }
 
-double Solver::applyBorderInsulation(const Index &index) const {
-    const auto &node = T(0)(index.x(), index.y());
-    const Eigen::Vector2d normal = getNormalToBorder(index, node);
-    Eigen::Vector2d antiNormal = -normal;
-    const auto offsetX = antiNormal.x() >= 0. ? -1 : 1;
-    const auto offsetY = antiNormal.y() >= 0. ? -1 : 1;
-    const auto i = index.x();
-    const auto j = index.y();
-
+template <typename Scalar>
+double Solver<Scalar>::applyBorderInsulation(const BorderStencil &stencil, const Scalar *layer) const {
     const double dx = step;
     const double dy = step;
 
-    const double dxdy = T(0)(i + offsetX, j + offsetY) - T(0)(i + offsetX, j) - T(0)(i, j + offsetY) + T(0)(i, j);
+    const double dxdy = layer[stencil.diagonal] - layer[stencil.x] - layer[stencil.y] + layer[stencil.node];
 
-    return dt * (-2 * dxdy / dx / dy) + T(0)(i, j);
+    return dt * (-2 * dxdy / dx / dy) + layer[stencil.node];
 }
 
-void Solver::implicitCentralDifference() {
-    const auto rows = T(0).rows();
-    const auto cols = T(0).cols();
+template <typename Scalar> bool Solver<Scalar>::isInterior(const ObjectBound part) const {
+    return !EnumBitmask::contains(params.border.bound(), part) && !EnumBitmask::contains(ObjectBounds::Outer, part);
+}
+
+/**
+ * The border masks of the variant are only read while classifying nodes, so the condition of a group is the one branch
+ * left per node. It is fixed for the group and resolved here at compile time; the part of the node only changes the
+ * cached stencil terms.
+ */
+template <typename Scalar>
+template <bool Convection>
+void Solver<Scalar>::updateBorderNodes(const BorderGroup &group, const int begin, const int end, const Layer &layer,
+                                       Layer &next) const {
+    const auto *current = layer.data();
+    auto *target = next.data();
 
-    Eigen::VectorXd tNew = meshCoeffs.partialPivLu().solve(meshFreeCoeffs);
-    for (int i = 0; i < rows; i++)
-        for (int j = 0; j < cols; j++) {
-            auto &node = T(1)(i, j);
-            if (!EnumBitmask::contains(params.border.bound(), node.part) &&
-                !EnumBitmask::contains(ObjectBounds::Outer, node.part))
-                node.t = tNew(i * cols + j);
+    for (int n = begin; n < end; n++) {
+        const auto &stencil = group.stencils[n];
+        if constexpr (Convection)
+            target[stencil.node] = static_cast<Scalar>(applyBorderConvection(stencil, current));
+        else
+            target[stencil.node] = static_cast<Scalar>(applyBorderInsulation(stencil, current));
+    }
+}
+
+template <typename Scalar>
+void Solver<Scalar>::updateBorderGroup(const BorderGroup &group, const int begin, const int end, const Layer &layer,
+                                       Layer &next) const {
+    if (group.convection)
+        updateBorderNodes<true>(group, begin, end, layer, next);
+    else
+        updateBorderNodes<false>(group, begin, end, layer, next);
+}
+
+template <typename Scalar>
+double Solver<Scalar>::borderChange(const BorderGroup &group, const int begin, const int end, const Layer &layer,
+                                    const Layer &next) const {
+    Scalar change = 0;
+    for (int n = begin; n < end; n++) {
+        const auto node = group.stencils[n].node;
+        change = std::max(change, std::abs(next.data()[node] - layer.data()[node]));
+    }
+    return static_cast<double>(change);
+}
+
+/**
+ * @return largest change of a border node when looking for the steady state, zero otherwise
+ */
+template <typename Scalar> double Solver<Scalar>::updateBorders(const Layer &layer, Layer &next) const {
+    static constexpr int Chunk = 64;
+    const auto measure = steadyTolerance >= 0.;
+    double change = 0.;
+
+#pragma omp parallel reduction(max : change)
+    for (const auto &group : borderGroups) {
+        const auto size = static_cast<int>(group.stencils.size());
+#pragma omp for nowait
+        for (int begin = 0; begin < size; begin += Chunk) {
+            const auto end = std::min(begin + Chunk, size);
+            updateBorderGroup(group, begin, end, layer, next);
+            if (measure)
+                change = std::max(change, borderChange(group, begin, end, layer, next));
         }
+    }
+
+    return change;
 }
 
-Eigen::MatrixXd Solver::buildCoefficientMatrix() const {
-    using namespace Eigen;
+template <typename Scalar> void Solver<Scalar>::classifyNodes() {
+    using namespace EnumBitmask;
 
-    MatrixXd coefficients = MatrixXd::Zero(T(0).size(), T(0).size());
-    const auto dx = step;
-    const auto dy = step;
+    /**
+     * Node parts and border conditions never change during a run, so every layer is driven by these lists instead of
+     * classifying each node again. Heat has priority over convection and convection over insulation.
+     * Nodes are visited in the storage order, so neighbouring interior nodes along x merge into runs. Runs end at
+     * the row chunks of the blocked mode, whose starts are recorded for every column.
+     */
+    const auto rows = static_cast<int>(T(0).rows());
+    const auto chunkRows = (rows + columnChunks - 1) / columnChunks;
+    columnChunks = (rows + chunkRows - 1) / chunkRows;
+
+    borderGroups = {{true, {}, {}}, {false, {}, {}}};
+    for (int j = 0; j < T(0).cols(); j++) {
+        for (int i = 0; i < rows; i++) {
+            if (i % chunkRows == 0) {
+                runChunkStarts.push_back(static_cast<int>(interiorRuns.size()));
+                for (auto &group : borderGroups)
+                    group.chunkStarts.push_back(static_cast<int>(group.stencils.size()));
+            }
+
+            const auto part = parts(i, j);
+            if (contains(params.border.Heat, part)) {
+                const auto t = part == ObjectBound::R2 ? 200. : 100.;
+                T(0)(i, j) = t;
+                T(1)(i, j) = t;
+            } else if (contains(params.border.Convection, part) || contains(params.border.ThermalInsulation, part)) {
+                const auto convection = contains(params.border.Convection, part);
+                auto &group = borderGroups[convection ? 0 : 1];
+                group.stencils.push_back(borderStencil({i, j}, part));
+            } else if (!contains(ObjectBounds::Outer, part)) {
+                auto *last = interiorRuns.empty() ? nullptr : &interiorRuns.back();
+                if (last && last->start.y() == j && last->start.x() + last->length == i && i % chunkRows != 0)
+                    last->length++;
+                else
+                    interiorRuns.push_back({{i, j}, 1});
+            }
+        }
+    }
+    runChunkStarts.push_back(static_cast<int>(interiorRuns.size()));
+    for (auto &group : borderGroups)
+        group.chunkStarts.push_back(static_cast<int>(group.stencils.size()));
+}
+
+template <typename Scalar> void Solver<Scalar>::explicitRun(const NodeRun &run, const Layer &layer, Layer &next) const {
+    const auto &[start, length] = run;
+    const auto i = start.x();
+    const auto j = start.y();
+    const auto dx = static_cast<Scalar>(step);
+    const auto dy = static_cast<Scalar>(step);
+    const auto tau = static_cast<Scalar>(dt);
+
+    /**
+     * A run of interior nodes along x is five unit-stride segments of the layer. Eigen vectorizes the stencil with
+     * the widest instruction set enabled at compile time and falls back to scalar code otherwise; single precision
+     * layers fit twice as many nodes into a register.
+     */
+    const auto A = layer.col(j).segment(i, length).array();
+    const auto B = layer.col(j).segment(i - 1, length).array();
+    const auto C = layer.col(j).segment(i + 1, length).array();
+    const auto D = layer.col(j - 1).segment(i, length).array();
+    const auto E = layer.col(j + 1).segment(i, length).array();
+
+    next.col(j).segment(i, length).array() = tau * ((C - 2 * A + B) / dx / dx + (E - 2 * A + D) / dy / dy) + A;
+}
+
+template <typename Scalar>
+double Solver<Scalar>::runChange(const NodeRun &run, const Layer &layer, const Layer &next) const {
+    const auto &[start, length] = run;
+    const auto updated = next.col(start.y()).segment(start.x(), length);
+    const auto previous = layer.col(start.y()).segment(start.x(), length);
+
+    return static_cast<double>((updated - previous).cwiseAbs().maxCoeff());
+}
+
+/**
+ * @return largest change of an interior node when looking for the steady state, zero otherwise. It is taken right
+ * after each run is updated, while the run is still in cache
+ */
+template <typename Scalar> double Solver<Scalar>::explicitInteriorKernel() {
+    const auto runs = static_cast<int>(interiorRuns.size());
+    const auto measure = steadyTolerance >= 0.;
+    double change = 0.;
+
+#pragma omp parallel for schedule(dynamic, 16) reduction(max : change)
+    for (int n = 0; n < runs; n++) {
+        explicitRun(interiorRuns[n], T(0), T(1));
+        if (measure)
+            change = std::max(change, runChange(interiorRuns[n], T(0), T(1)));
+    }
+
+    return change;
+}
+
+template <typename Scalar> double Solver<Scalar>::interiorChange() const {
+    const auto runs = static_cast<int>(interiorRuns.size());
+    double change = 0.;
 
-    coefficients.diagonal().setConstant(1. + 2. * dt / dx + 2. * dt / dy);
-    coefficients.diagonal(1).setConstant(dt / dy);
-    coefficients.diagonal(2).setConstant(dt / dx);
-    coefficients.diagonal(-1).setConstant(dt / dy);
-    coefficients.diagonal(-2).setConstant(dt / dx);
+#pragma omp parallel for schedule(dynamic, 16) reduction(max : change)
+    for (int n = 0; n < runs; n++)
+        change = std::max(change, runChange(interiorRuns[n], T(0), T(1)));
+
+    return change;
+}
+
+template <typename Scalar> void Solver<Scalar>::explicitChunk(const int chunk, const Layer &layer, Layer &next) const {
+    for (const auto &group : borderGroups)
+        updateBorderGroup(group, group.chunkStarts[chunk], group.chunkStarts[chunk + 1], layer, next);
+    for (int n = runChunkStarts[chunk]; n < runChunkStarts[chunk + 1]; n++)
+        explicitRun(interiorRuns[n], layer, next);
+}
+
+template <typename Scalar> void Solver<Scalar>::buildTiles() {
+    const auto rows = static_cast<int>(T(0).rows());
+    const auto cols = static_cast<int>(T(0).cols());
+    const auto tileRows = (rows + TileSize - 1) / TileSize;
+    tileColumns = (cols + TileSize - 1) / TileSize;
+
+    tiles.resize(tileRows * tileColumns);
+    for (int ti = 0; ti < tileRows; ti++)
+        for (int tj = 0; tj < tileColumns; tj++) {
+            auto &tile = tiles[ti * tileColumns + tj];
+            tile.row = ti * TileSize;
+            tile.col = tj * TileSize;
+            tile.rows = std::min(TileSize, rows - tile.row);
+            tile.cols = std::min(TileSize, cols - tile.col);
+            for (const auto &group : borderGroups)
+                tile.borders.push_back({group.convection, {}, {}});
+        }
+
+    // Runs are cut at the tile rows, border nodes go to the tile that holds them
+    for (const auto &[start, length] : interiorRuns)
+        for (int i = start.x(); i < start.x() + length;) {
+            const auto end = std::min(start.x() + length, (i / TileSize + 1) * TileSize);
+            tiles[i / TileSize * tileColumns + start.y() / TileSize].runs.push_back({{i, start.y()}, end - i});
+            i = end;
+        }
+
+    for (std::size_t g = 0; g < borderGroups.size(); g++)
+        for (const auto &stencil : borderGroups[g].stencils) {
+            const auto i = stencil.node % rows;
+            const auto j = stencil.node / rows;
+            tiles[i / TileSize * tileColumns + j / TileSize].borders[g].stencils.push_back(stencil);
+        }
+
+    activeTiles.resize(tiles.size());
+}
+
+template <typename Scalar> double Solver<Scalar>::explicitTiledStep() {
+    const auto count = static_cast<int>(tiles.size());
+    const auto tileRows = count / tileColumns;
+
+    /**
+     * A node only reads its neighbours, so a change moves by one node per layer and takes a whole epoch of TileSize
+     * layers to cross a tile. The skipped tiles are chosen once per epoch and the changes are only measured on its
+     * last layer: a tile is computed if it or an adjacent tile changed by more than the tolerance, or if drifting by
+     * its last rate until the end of the epoch would take it more than the tolerance away from where it was last
+     * computed. With a zero tolerance only tiles that would be recomputed to the same values are skipped, and the
+     * result is exact.
+     */
+    if (tileLayer == 0) {
+        const auto empty = [](const Tile &tile) {
+            return tile.runs.empty() && std::all_of(tile.borders.begin(), tile.borders.end(),
+                                                    [](const BorderGroup &group) { return group.stencils.empty(); });
+        };
+        allTilesActive = true;
+        for (int ti = 0; ti < tileRows; ti++)
+            for (int tj = 0; tj < tileColumns; tj++) {
+                const auto &tile = tiles[ti * tileColumns + tj];
+                bool active = !(tile.drift + TileSize * tile.rate <= skipTolerance);
+                for (int ni = std::max(ti - 1, 0); ni <= std::min(ti + 1, tileRows - 1); ni++)
+                    for (int nj = std::max(tj - 1, 0); nj <= std::min(tj + 1, tileColumns - 1); nj++)
+                        active = active || !(tiles[ni * tileColumns + nj].change <= skipTolerance);
+                activeTiles[ti * tileColumns + tj] = active;
+                allTilesActive = allTilesActive && (active || empty(tile));
+            }
+    }
+    const auto measure = tileLayer == TileSize - 1;
+    tileLayer = (tileLayer + 1) % TileSize;
+
+    // Nothing to skip, the whole layer goes through the untiled chunks
+    if (allTilesActive && !measure) {
+        const auto chunks = static_cast<int>(runChunkStarts.size()) - 1;
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int chunk = 0; chunk < chunks; chunk++)
+            explicitChunk(chunk, T(0), T(1));
+        for (auto &tile : tiles) {
+            tile.drift = 0.;
+            tile.synced = false;
+        }
+        return std::numeric_limits<double>::infinity();
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < count; t++) {
+        auto &tile = tiles[t];
+        const auto current = T(0).block(tile.row, tile.col, tile.rows, tile.cols);
+        auto next = T(1).block(tile.row, tile.col, tile.rows, tile.cols);
+
+        if (!activeTiles[t]) {
+            // The older layer in T(1) still has to catch up once before the buffers agree
+            if (!tile.synced)
+                next = current;
+            tile.synced = true;
+            tile.drift += tile.rate;
+            tile.change = 0.;
+            continue;
+        }
+
+        tile.drift = 0.;
+        tile.synced = false;
+        if (!measure) {
+            for (const auto &group : tile.borders)
+                updateBorderGroup(group, 0, static_cast<int>(group.stencils.size()), T(0), T(1));
+            for (const auto &run : tile.runs)
+                explicitRun(run, T(0), T(1));
+            continue;
+        }
+
+        tile.change = 0.;
+        for (const auto &group : tile.borders) {
+            const auto size = static_cast<int>(group.stencils.size());
+            updateBorderGroup(group, 0, size, T(0), T(1));
+            tile.change = std::max(tile.change, borderChange(group, 0, size, T(0), T(1)));
+        }
+        for (const auto &run : tile.runs) {
+            explicitRun(run, T(0), T(1));
+            tile.change = std::max(tile.change, runChange(run, T(0), T(1)));
+        }
+        tile.rate = tile.change;
+    }
+
+    if (!measure)
+        return std::numeric_limits<double>::infinity();
+
+    // A skipped tile did not move, but it is only as settled as it was when last computed
+    double change = 0.;
+    for (const auto &tile : tiles)
+        change = std::max(change, tile.rate);
+    return change;
+}
+
+template <typename Scalar> void Solver<Scalar>::solveExplicitBlock(const int layers) {
+    const auto cols = static_cast<int>(T(0).cols());
+
+    /**
+     * Skewed wavefront over the columns: on step w, layer s + 1 is computed at column w - 2s. Every update reaches one
+     * column to each side, so layer s is already complete around that column, and the older layer s - 1 it overwrites
+     * in the same buffer is no longer read. The stages of one step and the row chunks of their columns are all
+     * independent, and the columns touched by a step stay in cache while the wavefront moves over the plate.
+     */
+    const auto chunks = columnChunks;
+#pragma omp parallel
+    for (int w = 0; w < cols + 2 * (layers - 1); w++) {
+#pragma omp for collapse(2) schedule(static)
+        for (int s = 0; s < layers; s++)
+            for (int c = 0; c < chunks; c++)
+                if (const auto j = w - 2 * s; j >= 0 && j < cols)
+                    explicitChunk(j * chunks + c, T(s % 2), T((s + 1) % 2));
+    }
+
+    if (layers % 2 == 1)
+        T(0).swap(T(1));
+
+    // Blocks do not track the changes
+    layerChange = std::numeric_limits<double>::infinity();
+    // The next single step computes and measures every tile, then a new epoch starts
+    tileLayer = TileSize - 1;
+    allTilesActive = true;
+    std::fill(activeTiles.begin(), activeTiles.end(), 1);
+    for (auto &tile : tiles) {
+        tile.change = std::numeric_limits<double>::infinity();
+        tile.rate = std::numeric_limits<double>::infinity();
+        tile.synced = false;
+    }
+}
+
+/**
+ * Share of dt taken by the implicit operator (I - weight * dt * Laplacian) of a scheme
+ */
+static double implicitWeight(const config::SolvingMethod scheme) {
+    switch (scheme) {
+    case config::SolvingMethod::CrankNicolson:
+        return 1. / 2.;
+    case config::SolvingMethod::BDF2:
+        return 2. / 3.;
+    default:
+        return 1.;
+    }
+}
+
+template <typename Scalar> void Solver<Scalar>::implicitCentralDifference(const config::SolvingMethod scheme) {
+    const Eigen::VectorXd current = unknownsVector(0);
+    meshFreeCoeffs = buildFreeDicksVector(scheme, current);
+    if (scheme == config::SolvingMethod::BDF2)
+        previousLayer = current;
+
+    if (linearSolver == config::LinearSolver::RedBlackSOR) {
+        linearIterations.push_back(successiveOverRelaxation());
+        return;
+    }
+
+    Eigen::VectorXd tNew;
+    Eigen::ComputationInfo info = Eigen::Success;
+    switch (linearSolver) {
+    case config::LinearSolver::Direct:
+        tNew = fillPermutation.transpose() * factorization.solve(fillPermutation * meshFreeCoeffs);
+        break;
+    case config::LinearSolver::MixedDirect:
+        tNew = current;
+        linearIterations.push_back(refineMixedSolution(tNew));
+        break;
+    case config::LinearSolver::JacobiCG:
+        tNew = jacobiCG.solveWithGuess(meshFreeCoeffs, current);
+        linearIterations.push_back(static_cast<int>(jacobiCG.iterations()));
+        info = jacobiCG.info();
+        break;
+    case config::LinearSolver::CholeskyCG:
+        tNew = choleskyCG.solveWithGuess(meshFreeCoeffs, current);
+        linearIterations.push_back(static_cast<int>(choleskyCG.iterations()));
+        info = choleskyCG.info();
+        break;
+    case config::LinearSolver::Multigrid:
+        tNew = current;
+        linearIterations.push_back(multigrid.solveWithGuess(meshFreeCoeffs, tNew, tolerance, MaxMultigridCycles));
+        info = multigrid.info();
+        break;
+    case config::LinearSolver::MultigridCG:
+        tNew = multigridCG.solveWithGuess(meshFreeCoeffs, current);
+        linearIterations.push_back(static_cast<int>(multigridCG.iterations()));
+        info = multigridCG.info();
+        break;
+    case config::LinearSolver::MatrixFreeCG:
+        tNew = matrixFreeCG.solveWithGuess(meshFreeCoeffs, current);
+        linearIterations.push_back(static_cast<int>(matrixFreeCG.iterations()));
+        info = matrixFreeCG.info();
+        break;
+    case config::LinearSolver::SchwarzCG:
+        tNew = schwarzCG.solveWithGuess(meshFreeCoeffs, current);
+        linearIterations.push_back(static_cast<int>(schwarzCG.iterations()));
+        info = schwarzCG.info();
+        break;
+    case config::LinearSolver::RedBlackSOR:
+        break;
+    }
+    if (info != Eigen::Success)
+        throw std::runtime_error("Linear solver did not converge on the implicit layer");
+
+    auto *next = T(1).data();
+    const auto size = static_cast<int>(unknownNodes.size());
+#pragma omp parallel for
+    for (int unknown = 0; unknown < size; unknown++)
+        next[unknownNodes(unknown)] = static_cast<Scalar>(tNew(unknown));
+}
+
+template <typename Scalar>
+Eigen::SparseMatrix<double> Solver<Scalar>::buildCoefficientMatrix(const config::SolvingMethod scheme) const {
+    using namespace Eigen;
 
     const auto rows = T(0).rows();
     const auto cols = T(0).cols();
+    const auto dx = step;
+    const auto dy = step;
+    const auto rx = implicitWeight(scheme) * dt / dx / dx;
+    const auto ry = implicitWeight(scheme) * dt / dy / dy;
 
-    for (int i = 0; i < rows; i++)
-        for (int j = 0; j < cols; j++) {
-            const auto &node = T(0)(i, j);
-            if (EnumBitmask::contains(params.border.bound(), node.part)) {
-                coefficients.row(i * cols + j).setZero();
-                coefficients.col(i * cols + j).setZero();
-            }
+    /**
+     * Only interior nodes are unknowns; they keep the storage order of the grid. Border and outer nodes are
+     * eliminated from the columns of their neighbours (their values go to the free vector), which keeps
+     * the operator symmetric positive definite.
+     */
+    std::vector<Triplet<double>> triplets;
+    triplets.reserve(5 * unknownNodes.size());
+    for (int j = 0; j < cols; j++)
+        for (int i = 0; i < rows; i++) {
+            const auto row = unknownIndex(i + j * rows);
+            if (row < 0)
+                continue;
+
+            triplets.emplace_back(row, row, 1. + 2. * rx + 2. * ry);
+            const auto couple = [&](const int ni, const int nj, const double coefficient) {
+                if (const auto column = unknownIndex(ni + nj * rows); column >= 0)
+                    triplets.emplace_back(row, column, -coefficient);
+            };
+            couple(i - 1, j, rx);
+            couple(i + 1, j, rx);
+            couple(i, j - 1, ry);
+            couple(i, j + 1, ry);
         }
 
+    SparseMatrix<double> coefficients(unknownNodes.size(), unknownNodes.size());
+    coefficients.setFromTriplets(triplets.begin(), triplets.end());
     return coefficients;
 }
 
-Solution Solver::solveExplicit() {
+template <typename Scalar> template <config::SolvingMethod Type> Solution Solver<Scalar>::solveLayers() {
     ProgressBar bar{static_cast<float>(SizeT - 1)};
-    for (int currentTime = 0; currentTime < SizeT - 1; currentTime++, bar++) {
+    std::optional<int> steadyLayer;
+    int currentTime = 0;
+    while (currentTime < SizeT - 1) {
         if (SavedTemperatures.size() != 1)
-            SavedTemperatures(currentTime) = T(0).cast<float>();
+            SavedTemperatures(currentTime) = T(0).template cast<float>();
 
         std::cout << bar;
-        solveNextLayer<config::SolvingMethod::Explicit>();
+
+        // Output layers that are not saved are not needed either, so a time block may span several of them
+        if constexpr (Type == config::SolvingMethod::Explicit) {
+            // Merged layers are grouped so that every pass still advances about a time block of steps
+            const auto span = static_cast<int>((static_cast<long long>(timeBlock) * (SizeT - 1) + explicitSteps - 1) /
+                                               explicitSteps);
+            const auto layers = SavedTemperatures.size() == 1 ? std::min(span, SizeT - 1 - currentTime) : 1;
+            const auto stepsUntil = [&](const int layer) {
+                return static_cast<int>(static_cast<long long>(layer) * explicitSteps / (SizeT - 1));
+            };
+            advanceExplicit(stepsUntil(currentTime + layers) - stepsUntil(currentTime));
+            for (int layer = 0; layer < layers; layer++, currentTime++)
+                bar++;
+        } else {
+            solveNextLayer<Type>();
+            currentTime++;
+            bar++;
+        }
+
+        if (steadyTolerance >= 0. && layerChange <= steadyTolerance) {
+            steadyLayer = currentTime;
+            break;
+        }
     }
     std::cout << "\n";
 
+    if (steadyLayer) {
+        std::cerr << "Reached the steady state at layer " << *steadyLayer << std::endl;
+        if (SavedTemperatures.size() != 1) {
+            SavedTemperatures(currentTime) = T(0).template cast<float>();
+            SavedTemperatures.conservativeResize(currentTime + 1);
+        }
+    }
+
     if (SavedTemperatures.size() == 1)
-        SavedTemperatures(0) = T(0).cast<float>();
+        SavedTemperatures(0) = T(0).template cast<float>();
 
-    return {std::move(SavedTemperatures), step};
+    return {std::move(SavedTemperatures), step, std::move(linearIterations), steadyLayer};
 }
 
-Solution Solver::solveImplicit() {
-    meshCoeffs = buildCoefficientMatrix();
-    meshFreeCoeffs = buildFreeDicksVector();
+template <typename Scalar> void Solver<Scalar>::advanceExplicit(int steps) {
+    if (!superStages.empty()) {
+        for (; steps > 0; steps--)
+            superTimeStep();
+        return;
+    }
 
-    ProgressBar bar{static_cast<float>(SizeT - 1)};
-    for (int currentTime = 0; currentTime < SizeT - 1; currentTime++, bar++) {
-        if (SavedTemperatures.size() != 1)
-            SavedTemperatures(currentTime) = T(0).cast<float>();
+    while (steps > 0) {
+        auto layers = std::min(timeBlock, steps);
+        // The steady state monitor needs the last step on its own
+        if (steadyTolerance >= 0. && layers == steps && layers > 1)
+            layers--;
+        if (layers > 1)
+            solveExplicitBlock(layers);
+        else
+            solveNextLayer<config::SolvingMethod::Explicit>();
+        steps -= layers;
+    }
+}
 
-        std::cout << bar;
-        solveNextLayer<config::SolvingMethod::Implicit>();
+/**
+ * Second order Runge-Kutta-Legendre coefficients (Meyer, Balsara, Aslam 2014). An s-stage step is stable up to
+ * (s^2 + s - 2) / 4 forward Euler steps.
+ */
+template <typename Scalar>
+std::vector<typename Solver<Scalar>::SuperStage> Solver<Scalar>::rkl2Stages(const int stages) {
+    const auto b = [](const int j) { return j < 2 ? 1. / 3. : (j * j + j - 2.) / (2. * j * (j + 1.)); };
+    const auto w1 = 4. / (stages * stages + stages - 2.);
+
+    std::vector<SuperStage> coefficients;
+    coefficients.push_back({1., 0., b(1) * w1, 0.});
+    for (int j = 2; j <= stages; j++) {
+        const auto mu = (2. * j - 1.) / j * b(j) / b(j - 1);
+        const auto nu = -(j - 1.) / j * b(j) / b(j - 2);
+        coefficients.push_back({mu, nu, mu * w1, -(1. - b(j - 1)) * mu * w1});
     }
-    std::cout << "\n";
+    return coefficients;
+}
 
-    if (SavedTemperatures.size() == 1)
-        SavedTemperatures(0) = T(0).cast<float>();
+/**
+ * Interior nodes follow dT/dt = L(T), the first stage also stores dt L(Y_0), which every later stage reuses.
+ * Border nodes are left to superBorders.
+ */
+template <typename Scalar>
+void Solver<Scalar>::superStage(const SuperStage &stage, const Layer &previous, const Layer &older, Layer &next,
+                                const bool first) {
+    const auto &initial = T(0);
+    const auto mu = static_cast<Scalar>(stage.mu);
+    const auto nu = static_cast<Scalar>(stage.nu);
+    const auto rest = static_cast<Scalar>(1. - stage.mu - stage.nu);
+    const auto muTilde = static_cast<Scalar>(stage.muTilde);
+    const auto gammaTilde = static_cast<Scalar>(stage.gammaTilde);
+    const auto dx = static_cast<Scalar>(step);
+    const auto dy = static_cast<Scalar>(step);
+    const auto tau = static_cast<Scalar>(dt);
+    const auto runs = static_cast<int>(interiorRuns.size());
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int n = 0; n < runs; n++) {
+        const auto &[start, length] = interiorRuns[n];
+        const auto i = start.x();
+        const auto j = start.y();
+
+        const auto A = previous.col(j).segment(i, length).array();
+        const auto B = previous.col(j).segment(i - 1, length).array();
+        const auto C = previous.col(j).segment(i + 1, length).array();
+        const auto D = previous.col(j - 1).segment(i, length).array();
+        const auto E = previous.col(j + 1).segment(i, length).array();
+        const auto rate = tau * ((C - 2 * A + B) / dx / dx + (E - 2 * A + D) / dy / dy);
+
+        auto updated = next.col(j).segment(i, length).array();
+        auto initialSegment = initialRate.col(j).segment(i, length).array();
+        if (first) {
+            initialSegment = rate;
+            updated = A + muTilde * initialSegment;
+        } else
+            updated = mu * A + nu * older.col(j).segment(i, length).array() +
+                      rest * initial.col(j).segment(i, length).array() + muTilde * rate + gammaTilde * initialSegment;
+    }
+}
+
+/**
+ * Border nodes are held at Y_0 through the stages and updated once per layer from Y_0, like the explicit step does:
+ * iterating the convection update every stage is unstable, and the mixed difference of the insulation update
+ * along the hole has eigenvalues off the real axis, where the RKL stability region is thin. Insulation relaxes
+ * the node towards the value with a zero mixed difference; with the neighbours held the relaxation is exact over
+ * the layer, matches the explicit update for small dt and stays stable for any dt. Holding copies the border of
+ * Y_0 into every stage buffer before the first stage, the update writes the new border into T(1) after the last one.
+ */
+template <typename Scalar> void Solver<Scalar>::superBorders(const bool hold) {
+    static constexpr int Chunk = 64;
+    const auto *layer = T(0).data();
+    const auto insulationRelaxation = 1. - std::exp(-2. * dt / step / step);
+
+#pragma omp parallel
+    for (const auto &group : borderGroups) {
+        const auto size = static_cast<int>(group.stencils.size());
+#pragma omp for nowait
+        for (int begin = 0; begin < size; begin += Chunk)
+            for (int n = begin; n < std::min(begin + Chunk, size); n++) {
+                const auto &stencil = group.stencils[n];
+                if (hold) {
+                    // Every stage buffer, T(1) included, may be read by a stage
+                    T(1).data()[stencil.node] = layer[stencil.node];
+                    for (auto &buffer : stageLayers)
+                        buffer.data()[stencil.node] = layer[stencil.node];
+                    continue;
+                }
+
+                if (group.convection) {
+                    T(1).data()[stencil.node] = static_cast<Scalar>(applyBorderConvection(stencil, layer));
+                    continue;
+                }
+
+                const double dxdy = layer[stencil.diagonal] - layer[stencil.x] - layer[stencil.y] + layer[stencil.node];
+                T(1).data()[stencil.node] = static_cast<Scalar>(layer[stencil.node] - dxdy * insulationRelaxation);
+            }
+    }
+}
+
+template <typename Scalar> void Solver<Scalar>::superTimeStep() {
+    const auto stages = static_cast<int>(superStages.size());
+
+    // Y_0 is T(0), the last stage lands in T(1); three buffers are enough since a stage reads the two before it
+    const auto stageLayer = [&](const int j) -> Layer & {
+        if (j == 0)
+            return T(0);
+        const auto slot = (stages - j) % 3;
+        return slot == 0 ? T(1) : stageLayers[slot - 1];
+    };
+
+    superBorders(true);
+    for (int j = 1; j <= stages; j++)
+        superStage(superStages[j - 1], stageLayer(j - 1), stageLayer(std::max(j - 2, 0)), stageLayer(j), j == 1);
+    superBorders(false);
+
+    if (steadyTolerance >= 0.) {
+        layerChange = interiorChange();
+        for (const auto &group : borderGroups)
+            layerChange = std::max(layerChange, borderChange(group, 0, static_cast<int>(group.stencils.size()),
+                                                             T(0), T(1)));
+    }
+
+    T(0).swap(T(1));
+}
 
-    return {std::move(SavedTemperatures), step};
+/**
+ * Forward Euler on the 5-point Laplacian is stable while dt * (2 / dx^2 + 2 / dy^2) <= 1. The insulation update keeps
+ * a non-negative weight of the node itself up to dt = dx * dy / 2 and convection does not depend on dt, so the interior
+ * limit is the binding one.
+ */
+template <typename Scalar> double Solver<Scalar>::stableExplicitDt() const {
+    const double dx = step;
+    const double dy = step;
+
+    return 1. / (2. / dx / dx + 2. / dy / dy);
 }
 
-Eigen::VectorXd Solver::buildFreeDicksVector() const {
+template <typename Scalar> Solution Solver<Scalar>::solveExplicit() {
+    const auto stableDt = stableExplicitDt();
+    explicitSteps = SizeT - 1;
+    if (superTimeStepping) {
+        // The fewest stages whose stable range (s^2 + s - 2) / 4 covers the requested step
+        const auto stages = std::max(2, static_cast<int>(std::ceil((std::sqrt(9. + 16. * dt / stableDt) - 1.) / 2.)));
+        superStages = rkl2Stages(stages);
+        // Heat and outer nodes are never written by a stage, the buffers take them from the initial layer
+        stageLayers = {T(0), T(0)};
+        initialRate.setZero(T(0).rows(), T(0).cols());
+        std::cerr << "Taking every time layer as " << stages << " RKL2 stages" << std::endl;
+    } else if (adaptiveStep && SavedTemperatures.size() == 1) {
+        // Only the last layer is kept, so the whole span is covered by the fewest stable steps, longer or shorter
+        const auto span = (SizeT - 1) * dt;
+        explicitSteps = std::max(1, static_cast<int>(std::ceil(span / (MergedStepMargin * stableDt))));
+        dt = span / explicitSteps;
+        std::cerr << "Covering " << SizeT - 1 << " time layers with " << explicitSteps << " explicit steps of " << dt
+                  << std::endl;
+    } else if (dt > stableDt) {
+        if (adaptiveStep) {
+            // Snapshots stay on the requested grid, every interval is split into the fewest stable substeps
+            const auto substeps = static_cast<int>(std::ceil(dt / stableDt));
+            explicitSteps *= substeps;
+            dt /= substeps;
+            std::cerr << "Splitting every time layer into " << substeps << " explicit steps of " << dt << std::endl;
+        } else
+            std::cerr << "Warning: delta time " << dt << " exceeds the explicit stability limit " << stableDt
+                      << ", the solution is unstable. Enable adaptive_step or lower delta_time" << std::endl;
+    }
+
+    return solveLayers<config::SolvingMethod::Explicit>();
+}
+
+/**
+ * Iterative refinement on top of the single precision factorization: the residual is evaluated in double,
+ * only the corrections go through the float factor. A poor float factor makes the refinement stall or diverge,
+ * which throws once the step limit is reached.
+ * @return number of correction steps
+ */
+template <typename Scalar> int Solver<Scalar>::refineMixedSolution(Eigen::VectorXd &x) const {
+    const auto threshold = tolerance * meshFreeCoeffs.norm();
+    FlushDenormals guard;
+
+    int steps = 0;
+    Eigen::VectorXd residual = meshFreeCoeffs - meshCoeffs * x;
+    for (; steps < MaxRefinementSteps && residual.norm() > threshold; steps++) {
+        const Eigen::VectorXd permutedCorrection =
+            floatFactorization.solve((fillPermutation * residual).cast<float>()).cast<double>();
+        const Eigen::VectorXd correction = fillPermutation.transpose() * permutedCorrection;
+        x += correction;
+        residual = meshFreeCoeffs - meshCoeffs * x;
+    }
+    if (residual.norm() > threshold)
+        throw std::runtime_error("Iterative refinement did not converge in " + std::to_string(MaxRefinementSteps) +
+                                 " steps, the relative residual is " +
+                                 std::to_string(residual.norm() / meshFreeCoeffs.norm()));
+
+    return steps;
+}
+
+/**
+ * Red-black SOR on a double precision copy of T(0), which is also the warm start; the unknowns are written to T(1)
+ * afterwards. Single precision layers could not be relaxed past their rounding in place. Nodes of one colour only
+ * depend on the other colour, so each half-sweep is fully parallel. Throws if the sweep limit is reached first.
+ * @return number of sweeps
+ */
+template <typename Scalar> int Solver<Scalar>::successiveOverRelaxation() {
+    const auto rows = static_cast<int>(T(0).rows());
+    const auto cols = static_cast<int>(T(0).cols());
+    const auto rx = weightedDt / step / step;
+    const auto ry = weightedDt / step / step;
+    const auto diagonal = 1. + 2. * rx + 2. * ry;
+    const auto threshold = tolerance * meshFreeCoeffs.norm();
+
+    relaxationLayer = T(0).template cast<double>();
+    auto &u = relaxationLayer;
+
+    int sweep = 1;
+    double change = std::numeric_limits<double>::infinity();
+    for (; sweep <= MaxRelaxationSweeps; sweep++) {
+        change = 0.;
+        for (int colour = 0; colour < 2; colour++) {
+#pragma omp parallel for reduction(+ : change)
+            for (int j = 0; j < cols; j++)
+                for (int i = (j + colour) % 2; i < rows; i += 2) {
+                    const auto k = i + j * rows;
+                    const auto unknown = unknownIndex(k);
+                    if (unknown < 0)
+                        continue;
+
+                    // Border neighbours are already part of the free vector
+                    auto *t = u.data() + k;
+                    const auto sum = meshFreeCoeffs(unknown) + rx * ((unknownIndex(k - 1) >= 0) * t[-1]) +
+                                     rx * ((unknownIndex(k + 1) >= 0) * t[1]) +
+                                     ry * ((unknownIndex(k - rows) >= 0) * t[-rows]) +
+                                     ry * ((unknownIndex(k + rows) >= 0) * t[rows]);
+                    const auto delta = relaxation * (sum / diagonal - *t);
+                    *t += delta;
+                    change += delta * delta;
+                }
+        }
+
+        if (std::sqrt(change) <= threshold)
+            break;
+    }
+    if (std::sqrt(change) > threshold)
+        throw std::runtime_error("Red-black SOR did not converge in " + std::to_string(MaxRelaxationSweeps) +
+                                 " sweeps");
+
+    auto *next = T(1).data();
+    const auto size = static_cast<int>(unknownNodes.size());
+#pragma omp parallel for
+    for (int unknown = 0; unknown < size; unknown++) {
+        const auto k = unknownNodes(unknown);
+        next[k] = static_cast<Scalar>(u.data()[k]);
+    }
+
+    return sweep;
+}
+
+template <typename Scalar>
+Eigen::SparseMatrix<double, Eigen::RowMajor>
+Solver<Scalar>::buildBorderCouplingMatrix(const config::SolvingMethod scheme) const {
     using namespace Eigen;
 
     const auto rows = T(0).rows();
     const auto cols = T(0).cols();
     const auto dx = step;
     const auto dy = step;
+    const auto rx = implicitWeight(scheme) * dt / dx / dx;
+    const auto ry = implicitWeight(scheme) * dt / dy / dy;
 
-    VectorXd b = VectorXd::Zero(T(0).size());
-    for (int i = 0; i < rows; i++)
-        for (int j = 0; j < cols; j++) {
-            const auto &node = T(0)(i, j);
-            if (EnumBitmask::contains(params.border.bound(), node.part) ||
-                EnumBitmask::contains(ObjectBounds::Outer, node.part))
-                b(i * cols + j) = 0;
-            else {
-                b(i * cols + j) = node.t;
-                if (EnumBitmask::contains(params.border.bound(), T(0)(i - 1, j).part))
-                    b(i * cols + j) -= dt / dx;
-                if (EnumBitmask::contains(params.border.bound(), T(0)(i + 1, j).part))
-                    b(i * cols + j) -= dt / dx;
-                if (EnumBitmask::contains(params.border.bound(), T(0)(i, j - 1).part))
-                    b(i * cols + j) -= dt / dy;
-                if (EnumBitmask::contains(params.border.bound(), T(0)(i, j + 1).part))
-                    b(i * cols + j) -= dt / dy;
-            }
+    /**
+     * The columns eliminated from the operator: unknowns pick up their border neighbours from the grid here. Columns
+     * are storage indices of the layers, so the product reads the layers in place.
+     */
+    std::vector<Triplet<double>> triplets;
+    for (int j = 0; j < cols; j++)
+        for (int i = 0; i < rows; i++) {
+            const auto row = unknownIndex(i + j * rows);
+            if (row < 0)
+                continue;
+
+            const auto couple = [&](const int ni, const int nj, const double coefficient) {
+                if (const auto k = ni + nj * rows; unknownIndex(k) < 0)
+                    triplets.emplace_back(row, k, coefficient);
+            };
+            couple(i - 1, j, rx);
+            couple(i + 1, j, rx);
+            couple(i, j - 1, ry);
+            couple(i, j + 1, ry);
         }
 
+    SparseMatrix<double, RowMajor> coupling(unknownNodes.size(), T(0).size());
+    coupling.setFromTriplets(triplets.begin(), triplets.end());
+    return coupling;
+}
+
+/**
+ * Geometric nested dissection of the grid: both halves of a box are numbered before the grid line separating them,
+ * so the factor only fills in within the boxes and along the separators. Nodes are given by their storage index.
+ */
+static void nestedDissection(const int i0, const int i1, const int j0, const int j1, const int rows,
+                             std::vector<int> &order) {
+    if ((i1 - i0) * (j1 - j0) <= 64) {
+        for (int j = j0; j < j1; j++)
+            for (int i = i0; i < i1; i++)
+                order.push_back(i + j * rows);
+        return;
+    }
+
+    if (i1 - i0 >= j1 - j0) {
+        const auto middle = (i0 + i1) / 2;
+        nestedDissection(i0, middle, j0, j1, rows, order);
+        nestedDissection(middle + 1, i1, j0, j1, rows, order);
+        for (int j = j0; j < j1; j++)
+            order.push_back(middle + j * rows);
+    } else {
+        const auto middle = (j0 + j1) / 2;
+        nestedDissection(i0, i1, j0, middle, rows, order);
+        nestedDissection(i0, i1, middle + 1, j1, rows, order);
+        for (int i = i0; i < i1; i++)
+            order.push_back(i + middle * rows);
+    }
+}
+
+/**
+ * Applies the fill-reducing ordering to meshCoeffs. The permutation only depends on the grid,
+ * so it is computed once and kept next to the factor for the substitutions.
+ */
+template <typename Scalar> Eigen::SparseMatrix<double> Solver<Scalar>::permutedCoefficientMatrix() {
+    if (fillPermutation.size() != meshCoeffs.rows()) {
+        Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> inverse;
+        if (fillOrdering == config::FillOrdering::AMD)
+            Eigen::AMDOrdering<int>{}(meshCoeffs, inverse);
+        else {
+            std::vector<int> gridOrder;
+            gridOrder.reserve(T(0).size());
+            nestedDissection(0, static_cast<int>(T(0).rows()), 0, static_cast<int>(T(0).cols()),
+                             static_cast<int>(T(0).rows()), gridOrder);
+
+            inverse.resize(static_cast<int>(meshCoeffs.rows()));
+            int position = 0;
+            for (const auto k : gridOrder)
+                if (unknownIndex(k) >= 0)
+                    inverse.indices()(position++) = unknownIndex(k);
+        }
+        fillPermutation = inverse.inverse();
+    }
+
+    return fillPermutation * meshCoeffs * fillPermutation.transpose();
+}
+
+template <typename Scalar> void Solver<Scalar>::prepareImplicitOperator(const config::SolvingMethod scheme) {
+    const OperatorKey key{dt, step, scheme, linearSolver, params.border.bound(), params.hole.type, params.hole.center};
+    if (factorizedFor == key)
+        return;
+
+    const auto rows = static_cast<int>(T(0).rows());
+    const auto cols = static_cast<int>(T(0).cols());
+
+    /**
+     * Border, hole and outer nodes are known on every layer, so only interior nodes become unknowns.
+     * They are numbered in the storage order of the layers (i + j * rows), which keeps every grid column
+     * a contiguous range and lets gathers and scatters walk the layers forwards.
+     */
+    std::vector<int> nodes;
+    Eigen::VectorXi lineOffsets(cols + 1);
+    unknownIndex.setConstant(T(0).size(), -1);
+    for (int j = 0; j < cols; j++) {
+        lineOffsets(j) = static_cast<int>(nodes.size());
+        for (int i = 0; i < rows; i++)
+            if (isInterior(parts(i, j))) {
+                unknownIndex(i + j * rows) = static_cast<int>(nodes.size());
+                nodes.push_back(i + j * rows);
+            }
+    }
+    lineOffsets(cols) = static_cast<int>(nodes.size());
+    unknownNodes = Eigen::Map<Eigen::VectorXi>(nodes.data(), static_cast<Eigen::Index>(nodes.size()));
+    fillPermutation.resize(0);
+
+    weightedDt = implicitWeight(scheme) * dt;
+    implicitOperator = {unknownNodes, unknownIndex, rows, weightedDt / step / step, weightedDt / step / step};
+    borderCoupling = buildBorderCouplingMatrix(scheme);
+
+    // The matrix-free backends never touch the assembled operator
+    if (linearSolver == config::LinearSolver::Multigrid || linearSolver == config::LinearSolver::MatrixFreeCG ||
+        linearSolver == config::LinearSolver::RedBlackSOR)
+        meshCoeffs = {};
+    else
+        meshCoeffs = buildCoefficientMatrix(scheme);
+
+    Eigen::ComputationInfo info = Eigen::Success;
+    switch (linearSolver) {
+    case config::LinearSolver::Direct:
+        info = factorization.compute(permutedCoefficientMatrix()).info();
+        break;
+    case config::LinearSolver::MixedDirect: {
+        FlushDenormals guard;
+        info = floatFactorization.compute(permutedCoefficientMatrix().template cast<float>()).info();
+        break;
+    }
+    case config::LinearSolver::JacobiCG:
+        info = jacobiCG.compute(meshCoeffs).info();
+        break;
+    case config::LinearSolver::CholeskyCG:
+        info = choleskyCG.compute(meshCoeffs).info();
+        break;
+    case config::LinearSolver::Multigrid:
+        multigrid = buildMultigrid(scheme);
+        info = multigrid.info();
+        break;
+    case config::LinearSolver::MultigridCG:
+        multigridCG.preconditioner() = buildMultigrid(scheme);
+        info = multigridCG.compute(meshCoeffs).info();
+        break;
+    case config::LinearSolver::MatrixFreeCG:
+        matrixFreeCG.preconditioner() = buildMultigrid(scheme);
+        info = matrixFreeCG.compute(implicitOperator).info();
+        break;
+    case config::LinearSolver::RedBlackSOR: {
+        // Optimal relaxation from the spectral radius of the Jacobi iteration for the rectangular grid
+        const auto r = weightedDt / step / step;
+        const auto jacobiRadius = 2. * r * (std::cos(M_PI / rows) + std::cos(M_PI / cols)) / (1. + 4. * r);
+        relaxation = 2. / (1. + std::sqrt(1. - jacobiRadius * jacobiRadius));
+        break;
+    }
+    case config::LinearSolver::SchwarzCG:
+        schwarzCG.preconditioner().setup(static_cast<int>(parallelism), lineOffsets, SchwarzOverlap);
+        info = schwarzCG.compute(meshCoeffs).info();
+        break;
+    }
+    if (info != Eigen::Success)
+        throw std::runtime_error("Failed to factorize the implicit operator");
+    factorizedFor = key;
+}
+
+template <typename Scalar> Solution Solver<Scalar>::solveImplicit() {
+    prepareImplicitOperator(config::SolvingMethod::Implicit);
+    linearIterations.clear();
+
+    return solveLayers<config::SolvingMethod::Implicit>();
+}
+
+template <typename Scalar> Solution Solver<Scalar>::solveCrankNicolson() {
+    prepareImplicitOperator(config::SolvingMethod::CrankNicolson);
+    linearIterations.clear();
+
+    return solveLayers<config::SolvingMethod::CrankNicolson>();
+}
+
+template <typename Scalar> Solution Solver<Scalar>::solveBDF2() {
+    prepareImplicitOperator(config::SolvingMethod::BDF2);
+    linearIterations.clear();
+
+    /**
+     * There is no layer before the first one, so it is extrapolated backwards with one explicit step.
+     * This turns the first BDF2 step into the theta = 2/3 scheme, which uses the same operator.
+     */
+    const auto rows = static_cast<int>(T(0).rows());
+    const auto cols = static_cast<int>(T(0).cols());
+    previousLayer = unknownsVector(0);
+    for (int j = 0; j < cols; j++)
+        for (int i = 0; i < rows; i++)
+            if (const auto unknown = unknownIndex(i + j * rows); unknown >= 0)
+                previousLayer(unknown) -= explicitCentralDifference({i, j}, T(0)) - T(0)(i, j);
+
+    return solveLayers<config::SolvingMethod::BDF2>();
+}
+
+template <typename Scalar> Solution Solver<Scalar>::solveADI() {
+    halfLayer.resize(T(0).rows(), T(0).cols());
+
+    return solveLayers<config::SolvingMethod::ADI>();
+}
+
+template <typename Scalar>
+Eigen::VectorXd Solver<Scalar>::buildFreeDicksVector(const config::SolvingMethod scheme,
+                                                     const Eigen::VectorXd &current) const {
+    /**
+     * Backward Euler:  T(0)
+     * Crank-Nicolson:  T(0) + dt / 2 * Laplacian(T(0))
+     * BDF2:            (4 * T(0) - T(-1)) / 3
+     * plus the border values of the new layer eliminated from the operator
+     */
+    Eigen::VectorXd b = current + borderTerms(1);
+
+    // The operator rows are I - dt / 2 * Laplacian without the border columns, which the coupling adds back
+    if (scheme == config::SolvingMethod::CrankNicolson)
+        b += current - implicitOperator * current + borderTerms(0);
+    else if (scheme == config::SolvingMethod::BDF2)
+        b += (current - previousLayer) / 3.;
+
     return b;
 }
+
+/**
+ * @return border values of the layer coupled into the unknowns, read straight from the layer storage. Each row only
+ * touches the few border neighbours of its unknown, so the layer is neither copied nor converted to double
+ */
+template <typename Scalar> Eigen::VectorXd Solver<Scalar>::borderTerms(const int time) const {
+    const auto *layer = T(time).data();
+    const auto size = static_cast<int>(borderCoupling.outerSize());
+
+    Eigen::VectorXd terms(size);
+#pragma omp parallel for
+    for (int row = 0; row < size; row++) {
+        double sum = 0.;
+        for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(borderCoupling, row); it; ++it)
+            sum += it.value() * static_cast<double>(layer[it.col()]);
+        terms(row) = sum;
+    }
+
+    return terms;
+}
+
+template <typename Scalar> Eigen::VectorXd Solver<Scalar>::unknownsVector(const int time) const {
+    const auto *layer = T(time).data();
+    const auto size = static_cast<int>(unknownNodes.size());
+
+    Eigen::VectorXd unknowns(size);
+#pragma omp parallel for
+    for (int unknown = 0; unknown < size; unknown++)
+        unknowns(unknown) = layer[unknownNodes(unknown)];
+
+    return unknowns;
+}
+
+template <typename Scalar> Multigrid Solver<Scalar>::buildMultigrid(const config::SolvingMethod scheme) const {
+    using namespace EnumBitmask;
+
+    return {parts, params.border.bound() | ObjectBounds::Outer, unknownNodes, implicitWeight(scheme) * dt, step};
+}
+
+/**
+ * Thomas algorithm for a line of the ADI sweep: diagonal 1 + 2r, off-diagonals -r.
+ * The solution overwrites `rhs`; `scratch` holds the modified upper diagonal.
+ */
+static void solveTridiagonal(std::vector<double> &rhs, std::vector<double> &scratch, const double r) {
+    const auto n = rhs.size();
+    const auto diagonal = 1. + 2. * r;
+    scratch.resize(n);
+
+    scratch[0] = -r / diagonal;
+    rhs[0] /= diagonal;
+    for (std::size_t k = 1; k < n; k++) {
+        const auto pivot = diagonal + r * scratch[k - 1];
+        scratch[k] = -r / pivot;
+        rhs[k] = (rhs[k] + r * rhs[k - 1]) / pivot;
+    }
+    for (std::size_t k = n - 1; k-- > 0;)
+        rhs[k] -= scratch[k] * rhs[k + 1];
+}
+
+template <typename Scalar> void Solver<Scalar>::alternatingDirectionImplicit() {
+    const auto rows = T(0).rows();
+    const auto cols = T(0).cols();
+    const auto dx = step;
+    const auto dy = step;
+    const auto rx = dt / 2. / dx / dx;
+    const auto ry = dt / 2. / dy / dy;
+
+    /**
+     * Peaceman-Rachford splitting: the first half step is implicit along x (explicit along y), the second one
+     * implicit along y. Every run of interior nodes between two border nodes is an independent tridiagonal system
+     * with the new layer's border values as its ends.
+     */
+#pragma omp parallel
+    {
+        std::vector<double> line;
+        std::vector<double> scratch;
+
+#pragma omp for
+        for (int j = 0; j < cols; j++)
+            for (int i = 0; i < rows; i++) {
+                if (!isInterior(parts(i, j))) {
+                    halfLayer(i, j) = T(1)(i, j);
+                    continue;
+                }
+
+                const auto begin = i;
+                line.clear();
+                for (; isInterior(parts(i, j)); i++) {
+                    const double A = T(0)(i, j);
+                    line.push_back(A + ry * (T(0)(i, j - 1) - 2 * A + T(0)(i, j + 1)));
+                }
+                line.front() += rx * T(1)(begin - 1, j);
+                line.back() += rx * T(1)(i, j);
+
+                solveTridiagonal(line, scratch, rx);
+                for (std::size_t k = 0; k < line.size(); k++)
+                    halfLayer(begin + k, j) = line[k];
+                halfLayer(i, j) = T(1)(i, j);
+            }
+
+#pragma omp for
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < cols; j++) {
+                if (!isInterior(parts(i, j)))
+                    continue;
+
+                const auto begin = j;
+                line.clear();
+                for (; isInterior(parts(i, j)); j++) {
+                    const double A = halfLayer(i, j);
+                    line.push_back(A + rx * (halfLayer(i - 1, j) - 2 * A + halfLayer(i + 1, j)));
+                }
+                line.front() += ry * T(1)(i, begin - 1);
+                line.back() += ry * T(1)(i, j);
+
+                solveTridiagonal(line, scratch, ry);
+                for (std::size_t k = 0; k < line.size(); k++)
+                    T(1)(i, begin + k) = line[k];
+            }
+    }
+}
+
+template class Solver<float>;
+template class Solver<double>;
@@ -45,7 +45,11 @@ ObjectBound BorderConditions::bound() const { return Heat | ThermalInsulation |
 bool Constants::operator==(const Constants &rhs) const {
     return TimeLayers == rhs.TimeLayers && DeltaTime == rhs.DeltaTime && Height == rhs.Height && Width == rhs.Width &&
            Radius2 == rhs.Radius2 && Radius1 == rhs.Radius1 && SquareSide == rhs.SquareSide && Variant == rhs.Variant &&
-           GridStep == rhs.GridStep && Kind == rhs.Kind;
+           GridStep == rhs.GridStep && Kind == rhs.Kind && ImplicitSolver == rhs.ImplicitSolver &&
+           SolverTolerance == rhs.SolverTolerance && Ordering == rhs.Ordering &&
+           TimeBlock == rhs.TimeBlock && AdaptiveStep == rhs.AdaptiveStep && LayerPrecision == rhs.LayerPrecision &&
+           SkipTolerance == rhs.SkipTolerance && SteadyTolerance == rhs.SteadyTolerance &&
+           CoarseLevels == rhs.CoarseLevels && SuperTimeStepping == rhs.SuperTimeStepping;
 }
 
 bool Constants::operator!=(const Constants &rhs) const { return !(rhs == *this); }
@@ -16,7 +16,75 @@
 #include "ffmpeg.h"
 #include "mesh.h"
 
+template <typename Scalar>
+Solution solve(Mesh &&mesh, const config::TaskParameters &params, const config::Constants &constants) {
+    // The coarse run goes until its steady state, the fine one continues the same time axis from there
+    auto fineConstants = constants;
+    std::optional<Solution> coarse;
+    int firstLayer = 0;
+    if (constants.CoarseLevels > 0) {
+        if (constants.SteadyTolerance < 0.)
+            throw std::runtime_error("Coarse levels need a steady tolerance to tell where the coarse run ends");
+
+        // Explicit steps are bound by the squared grid step, so the coarse grid takes four times longer ones
+        const auto stretch = constants.SolveMethod == config::SolvingMethod::Explicit ? 4 : 1;
+        auto coarseConstants = constants;
+        coarseConstants.GridStep *= 2;
+        coarseConstants.DeltaTime *= stretch;
+        coarseConstants.TimeLayers = (constants.TimeLayers + stretch - 2) / stretch + 1;
+        // Tolerances are per step, the same rate of change is allowed over a longer one
+        coarseConstants.SteadyTolerance *= stretch;
+        if (coarseConstants.SkipTolerance >= 0.)
+            coarseConstants.SkipTolerance *= stretch;
+        coarseConstants.CoarseLevels--;
+        coarseConstants.Kind = config::RenderKind::NoOutput;
+        std::cerr << "Solving on the coarse grid with step " << coarseConstants.GridStep << std::endl;
+        coarse = solve<Scalar>(Mesh{params, coarseConstants}, params, coarseConstants);
+
+        if (coarse->steadyLayer) {
+            firstLayer = std::min(*coarse->steadyLayer * stretch, constants.TimeLayers - 1);
+            fineConstants.TimeLayers -= firstLayer;
+        } else {
+            std::cerr << "Warning: the coarse run did not reach the steady state, the fine one starts over"
+                      << std::endl;
+            coarse.reset();
+        }
+    }
+
+    auto solver = Solver<Scalar>{std::move(mesh), fineConstants};
+    if (coarse)
+        solver.initializeFromCoarse(*coarse);
+    std::cerr << "Mesh created. Solving linear systems..." << std::endl;
+
+    Solution solution;
+    switch (constants.SolveMethod) {
+    case config::SolvingMethod::Explicit:
+        solution = solver.solveExplicit();
+        break;
+    case config::SolvingMethod::Implicit:
+        solution = solver.solveImplicit();
+        break;
+    case config::SolvingMethod::ADI:
+        solution = solver.solveADI();
+        break;
+    case config::SolvingMethod::CrankNicolson:
+        solution = solver.solveCrankNicolson();
+        break;
+    case config::SolvingMethod::BDF2:
+        solution = solver.solveBDF2();
+        break;
+    }
+
+    solution.firstLayer = firstLayer;
+    if (solution.steadyLayer)
+        *solution.steadyLayer += firstLayer;
+    return solution;
+}
+
 void process_solution(const config::Constants &constants, const Solution &solution) {
+    // The last layer is only saved when the run stopped early at the steady state
+    const auto layers = solution.timeMesh.size() - (solution.steadyLayer ? 0 : 1);
+
     if (constants.Kind == config::RenderKind::RenderLast) {
         auto writer = ImageWriter({constants.Width, constants.Height});
         for (int i = 0; i < solution.timeMesh(0).rows(); i++)
@@ -29,20 +97,21 @@ void process_solution(const config::Constants &constants, const Solution &soluti
         output << writer.write(heatmap_cs_Spectral_mixed);
     } else if (constants.Kind == config::RenderKind::OutputLast) {
         std::cout << "t x y T" << std::endl;
+        const auto time = solution.steadyLayer.value_or(constants.TimeLayers - 1);
         for (int i = 0; i < solution.timeMesh(0).rows(); i++)
             for (int j = 0; j < solution.timeMesh(0).cols(); j++)
-                std::cout << constants.TimeLayers - 1 << " " << i * solution.step << " " << j * solution.step << " "
+                std::cout << time << " " << i * solution.step << " " << j * solution.step << " "
                           << solution.timeMesh(0)(i, j) << std::endl;
     } else if (constants.Kind == config::RenderKind::OutputAll) {
         std::cout << "t x y T" << std::endl;
-        for (int time = 0; time < constants.TimeLayers - 1; time++)
+        for (int time = 0; time < layers; time++)
             for (int i = 0; i < solution.timeMesh(0).rows(); i++)
                 for (int j = 0; j < solution.timeMesh(0).cols(); j++)
-                    std::cout << time << " " << i * solution.step << " " << j * solution.step << " "
-                              << solution.timeMesh(time)(i, j) << std::endl;
+                    std::cout << solution.firstLayer + time << " " << i * solution.step << " " << j * solution.step
+                              << " " << solution.timeMesh(time)(i, j) << std::endl;
     } else if (constants.Kind == config::RenderKind::RenderGif) {
         auto gifWriter = GifImageWriter{heatmap_cs_Spectral_soft};
-        for (int time = 0; time < constants.TimeLayers - 1; time++) {
+        for (int time = 0; time < layers; time++) {
             auto frameWriter = ImageWriter{{constants.Width, constants.Height}};
             for (int i = 0; i < solution.timeMesh(0).rows(); i++)
                 for (int j = 0; j < solution.timeMesh(0).cols(); j++) {
@@ -58,7 +127,7 @@ void process_solution(const config::Constants &constants, const Solution &soluti
         std::size_t fps = 240;
         auto ffmpeg = FFMPEG{constants.Width, constants.Height, fps};
 
-        for (int time = 0; time < constants.TimeLayers - 1; time++) {
+        for (int time = 0; time < layers; time++) {
             auto frameWriter = ImageWriter{{constants.Width, constants.Height}};
             for (int i = 0; i < solution.timeMesh(0).rows(); i++)
                 for (int j = 0; j < solution.timeMesh(0).cols(); j++) {
@@ -99,15 +168,16 @@ int main() {
         return 0;
     }
 
-    auto solver = Solver{std::move(mesh), constants};
-    std::cerr << "Mesh created. Solving linear systems..." << std::endl;
-
-    Solution solution;
-    if (constants.SolveMethod == config::SolvingMethod::Explicit)
-        solution = solver.solveExplicit();
-    else
-        solution = solver.solveImplicit();
+    const auto solution = constants.LayerPrecision == config::Precision::Float
+                              ? solve<float>(std::move(mesh), params, constants)
+                              : solve<double>(std::move(mesh), params, constants);
     std::cerr << "Successfully calculated solution" << std::endl;
+    if (!solution.linearIterations.empty()) {
+        std::cerr << "Linear solver iterations per layer:";
+        for (const auto iterations : solution.linearIterations)
+            std::cerr << " " << iterations;
+        std::cerr << std::endl;
+    }
 
     process_solution(constants, solution);
 }